@@ -78,6 +78,13 @@ DECLARE_CONST(executor_select_prescaler);
  */
 DECLARE_CONST(executor_max_sleep_msec);
 
+/** Set to 1 to make executors use epoll instead of select on Linux.
+ *
+ * Removes the FD_SETSIZE limit and makes the cost of a wakeup proportional
+ * to the number of active FDs instead of the largest FD number.
+ */
+DECLARE_CONST(executor_use_epoll);
+
 /** Number of packets to queue in the CANbus device driver for send. Each packet
  * takes 16 bytes of RAM. */
 DECLARE_CONST(can_tx_buffer_size);
@@ -136,12 +143,25 @@ DECLARE_CONST(directhub_port_max_incoming_packets);
 /// will allocate at least this many bytes dedicated for each input port.
 DECLARE_CONST(directhub_port_incoming_buffer_size);
 
+/// Number of bytes a single DirectHub source may send to the hub before the
+/// admission controller makes it yield to the other sources.
+DECLARE_CONST(directhub_admission_quantum_bytes);
+
+/// Size in bytes of the per-thread ring buffers of deferred logging
+/// (DEFERRED_LOGGING, see BinaryLog). Must be a power of two, at least 256.
+DECLARE_CONST(binary_log_ring_size);
+
 /** Number of entries in the remote alias cache */
 DECLARE_CONST(remote_alias_cache_size);
 
 /** Number of entries in the local alias cache */
 DECLARE_CONST(local_alias_cache_size);
 
+/** How many destination alias lookups the addressed message write flow runs
+ * in parallel. Messages to other nodes keep flowing during the lookups. Zero
+ * makes the write flow wait for each lookup to complete. */
+DECLARE_CONST(remote_alias_parallel_lookups);
+
 /** Keep this many allocated but unused aliases around. (Currently supported
  * values are 0 or 1.) */
 DECLARE_CONST(reserve_unused_alias_count);
@@ -157,6 +177,14 @@ DECLARE_CONST(num_datagram_registry_entries);
  * happen concurrently. */
 DECLARE_CONST(num_datagram_clients);
 
+/** Number of multi-frame incoming datagrams that the CAN interface can
+ * reassemble at the same time. The buffers are allocated up front. */
+DECLARE_CONST(num_datagram_reassembly_buffers);
+
+/** Milliseconds after the last received frame when a partially received
+ * incoming datagram gets dropped. */
+DECLARE_CONST(datagram_reassembly_timeout_msec);
+
 /** Number of stream senders. This is how many stream send operations can
  * happen concurrently. */
 DECLARE_CONST(num_stream_senders);
@@ -182,6 +210,27 @@ DECLARE_CONST(bulk_alias_num_can_frames);
  * StreamReceiver }. */
 DECLARE_CONST(stream_receiver_default_window_size);
 
+/** Number of Producer/Consumer Identified messages that the event service
+ * collects into one batch when answering Identify Global or addressed
+ * Identify Events. Zero disables batching; then every event handler sends its
+ * own messages. */
+DECLARE_CONST(event_identify_batch_size);
+
+/** Set to CONSTANT_TRUE to make FilteringCanHubFlow use a directly indexed
+ * table (16 kbytes) of alias to destination ports, instead of a multimap that
+ * is allocated per learned alias. */
+DECLARE_CONST(can_filter_flat_table);
+
+/** How many 1 kbyte raw buffers the memory config stream read fills from the
+ * memory space in one read_vector call. Two such blocks are kept in RAM: one
+ * is being read while the other one is sent. */
+DECLARE_CONST(memory_stream_read_block_buffers);
+
+/** Largest configuration file (in bytes) that ConfigUpdateFlow reads into
+ * memory for serving the config reads of the update listeners. 0 disables the
+ * snapshot. */
+DECLARE_CONST(config_update_snapshot_max_size);
+
 /** Stack size for @ref SocketListener threads. */
 DECLARE_CONST(socket_listener_stack_size);
 
@@ -81,6 +81,23 @@
 #define OPENMRN_HAVE_PSELECT 1
 #endif
 
+#if defined(__linux__) || defined(__MACH__)
+/// ::writev is available to gather several buffers into one write syscall.
+#define OPENMRN_HAVE_WRITEV 1
+#endif
+
+#if defined(__linux__) || defined(__MACH__)
+/// The mainBufferPool keeps a free list for each thread allocating from it
+/// (see ThreadCachedPool).
+#define OPENMRN_FEATURE_BUFFER_THREAD_CACHE 1
+#endif
+
+#if defined(__linux__) && defined(OPENMRN_HAVE_PSELECT)
+/// The executor can use ::epoll_pwait instead of ::pselect (see
+/// ExecutorBase::use_epoll()).
+#define OPENMRN_HAVE_EPOLL 1
+#endif
+
 #if defined(__WINNT__) || defined(ESP_PLATFORM) || defined(ESP_NONOS)
 /// Uses ::select in the executor to sleep (unsure how wakeup is handled)
 #define OPENMRN_HAVE_SELECT 1
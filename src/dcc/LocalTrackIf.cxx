@@ -33,8 +33,9 @@
  * @date 24 Aug 2014
  */
 
-#include <unistd.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 #include "openmrn_features.h"
 #ifdef OPENMRN_FEATURE_FD_CAN_DEVICE
@@ -50,6 +51,7 @@
 #endif // OPENMRN_FEATURE_FD_CAN_DEVICE
 
 #include "dcc/LocalTrackIf.hxx"
+#include "utils/logging.h"
 
 namespace dcc
 {
@@ -80,8 +82,65 @@ StateFlowBase::Action LocalTrackIf::entry()
 
 StateFlowBase::Action LocalTrackIfSelect::entry() {
     HASSERT(fd_ >= 0);
-    auto *p = message()->data();
-    return write_repeated(&helper_, fd_, p, sizeof(*p), STATE(finish));
+    if (batchSize_ <= 1)
+    {
+        auto *p = message()->data();
+        return write_repeated(&helper_, fd_, p, sizeof(*p), STATE(finish));
+    }
+    batch_[batchCount_++] = transfer_message();
+    if (batchCount_ < batchSize_ && !queue_empty())
+    {
+        // Picks up the next queued packet into the batch.
+        return exit();
+    }
+    batchWritten_ = 0;
+    return call_immediately(STATE(write_batch));
+}
+
+StateFlowBase::Action LocalTrackIfSelect::write_batch()
+{
+    const size_t total = batchCount_ * sizeof(dcc::Packet);
+    while (batchWritten_ < total)
+    {
+        unsigned first = batchWritten_ / sizeof(dcc::Packet);
+        size_t ofs = batchWritten_ % sizeof(dcc::Packet);
+        uint8_t *data = reinterpret_cast<uint8_t *>(batch_[first]->data());
+#ifdef OPENMRN_HAVE_WRITEV
+        iov_[0].iov_base = data + ofs;
+        iov_[0].iov_len = sizeof(dcc::Packet) - ofs;
+        for (unsigned i = first + 1; i < batchCount_; ++i)
+        {
+            iov_[i - first].iov_base = batch_[i]->data();
+            iov_[i - first].iov_len = sizeof(dcc::Packet);
+        }
+        ssize_t ret = ::writev(fd_, iov_.get(), batchCount_ - first);
+#else
+        ssize_t ret = ::write(fd_, data + ofs, sizeof(dcc::Packet) - ofs);
+#endif
+        if (ret > 0)
+        {
+            batchWritten_ += ret;
+            continue;
+        }
+        if (ret < 0 &&
+            (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            // Blocked.
+            helper_.reset(Selectable::WRITE, fd_, Selectable::MAX_PRIO);
+            helper_.set_wakeup(this);
+            service()->executor()->select(&helper_);
+            return wait();
+        }
+        LOG(WARNING, "LocalTrackIf: dropping %u packets, write error %d",
+            batchCount_ - first, errno);
+        break;
+    }
+    for (unsigned i = 0; i < batchCount_; ++i)
+    {
+        batch_[i]->unref();
+    }
+    batchCount_ = 0;
+    return exit();
 }
 
 } // namespace dcc
@@ -36,9 +36,16 @@
 #ifndef _DCC_LOCALTRACKIF_HXX_
 #define _DCC_LOCALTRACKIF_HXX_
 
+#include <memory>
+
 #include "executor/Executor.hxx"
 #include "executor/StateFlow.hxx"
 #include "dcc/Packet.hxx"
+#include "openmrn_features.h"
+
+#ifdef OPENMRN_HAVE_WRITEV
+#include <sys/uio.h>
+#endif
 
 namespace dcc
 {
@@ -93,6 +100,13 @@ protected:
 /// device driver for producing the track signal.
 ///
 /// The device driver must support the select() model.
+///
+/// In batch mode the packets already waiting in the queue are collected (up
+/// to the batch size) and written with a single ::writev call. This is meant
+/// for host command stations driving the track through a character device,
+/// pipe or socket, where the syscall per packet limits the packet rate. The
+/// device has to accept any number of packets in one write; on targets
+/// without ::writev the batch is written one packet per ::write.
 class LocalTrackIfSelect : public LocalTrackIf
 {
 public:
@@ -101,17 +115,46 @@ public:
      * @param service Usually the main executor.
      * @param pool_size will determine how many packets the current flow's
      * alloc() will have.
+     * @param batch_size is the lookahead depth: how many queued packets may
+     * be written together. 1 writes each packet separately. Packets of a
+     * batch are held until the write, so this should not be larger than
+     * pool_size.
      */
-    LocalTrackIfSelect(Service *service, int pool_size)
+    LocalTrackIfSelect(Service *service, int pool_size, unsigned batch_size = 1)
         : LocalTrackIf(service, pool_size)
+        , batchSize_(batch_size)
     {
+        if (batchSize_ > 1)
+        {
+            batch_.reset(new Buffer<dcc::Packet> *[batchSize_]);
+#ifdef OPENMRN_HAVE_WRITEV
+            iov_.reset(new struct iovec[batchSize_]);
+#endif
+        }
     }
 
 protected:
     Action entry() OVERRIDE;
 
+    /// Writes the collected batch of packets. @return next action.
+    Action write_batch();
+
     /// Helper class for select() ing the target device.
     StateFlowSelectHelper helper_{this};
+
+private:
+    /// Maximum number of packets in one write.
+    unsigned batchSize_;
+    /// Number of packets in batch_.
+    unsigned batchCount_ {0};
+    /// Number of bytes of the batch already written.
+    size_t batchWritten_ {0};
+    /// Packets collected for the next write. We own one reference for each.
+    std::unique_ptr<Buffer<dcc::Packet> *[]> batch_;
+#ifdef OPENMRN_HAVE_WRITEV
+    /// Scatter list for the ::writev call.
+    std::unique_ptr<struct iovec[]> iov_;
+#endif
 };
 
 } // namespace dcc
@@ -26,8 +26,8 @@
  *
  * \file SimpleUpdateLoop.cxx
  *
- * Control flow central to the command station: it round-robins between
- * refreshing the individual trains.
+ * Control flow central to the command station: it schedules the update and
+ * refresh packets of the individual trains.
  *
  * @author Balazs Racz
  * @date 1 Feb 2015
@@ -43,8 +43,6 @@ namespace dcc
 SimpleUpdateLoop::SimpleUpdateLoop(Service *service, TrackIf *track_send)
     : StateFlow(service)
     , trackSend_(track_send)
-    , nextRefreshIndex_(0)
-    , lastCycleStart_(os_get_time_monotonic())
 {
 }
 
@@ -52,18 +50,199 @@ SimpleUpdateLoop::~SimpleUpdateLoop()
 {
 }
 
+bool SimpleUpdateLoop::add_refresh_source(
+    dcc::PacketSource *source, unsigned priority)
+{
+    long long now = os_get_time_monotonic();
+    AtomicHolder h(this);
+    bool ret = true;
+    for (const RefreshEntry &e : refreshSources_)
+    {
+        if (e.priority >= EXCLUSIVE_MIN_PRIORITY && e.priority > priority)
+        {
+            ret = false;
+        }
+    }
+    // A new source is eligible right away, and counts as recently changed.
+    refreshSources_.push_back(
+        {source, priority, false, now - MIN_SOURCE_GAP_NSEC, now});
+    return ret;
+}
+
+void SimpleUpdateLoop::remove_refresh_source(dcc::PacketSource *source)
+{
+    AtomicHolder h(this);
+    refreshSources_.erase(remove_if(refreshSources_.begin(),
+                              refreshSources_.end(),
+                              [source](const RefreshEntry &e) {
+                                  return e.source == source;
+                              }),
+        refreshSources_.end());
+    for (unsigned i = 0; i < numPending_;)
+    {
+        if (pending_[i].source == source)
+        {
+            erase_pending(i);
+            continue;
+        }
+        ++i;
+    }
+}
+
+void SimpleUpdateLoop::notify_update(PacketSource *source, unsigned code)
+{
+    long long now = os_get_time_monotonic();
+    AtomicHolder h(this);
+    int idx = find_source(source);
+    if (idx >= 0)
+    {
+        refreshSources_[idx].lastChange = now;
+    }
+    for (unsigned i = 0; i < numPending_; ++i)
+    {
+        if (pending_[i].source == source && pending_[i].code == code)
+        {
+            // Already queued. The packet will be generated from the freshest
+            // state anyway.
+            return;
+        }
+    }
+    if (numPending_ < MAX_PENDING_UPDATES)
+    {
+        pending_[numPending_++] = {source, code};
+    }
+    // else: the update is dropped. The source is still weighted up for being
+    // recently changed, so the background refresh will get to it soon.
+}
+
+int SimpleUpdateLoop::find_source(dcc::PacketSource *source)
+{
+    for (unsigned i = 0; i < refreshSources_.size(); ++i)
+    {
+        if (refreshSources_[i].source == source)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void SimpleUpdateLoop::erase_pending(unsigned idx)
+{
+    HASSERT(idx < numPending_);
+    --numPending_;
+    for (unsigned i = idx; i < numPending_; ++i)
+    {
+        pending_[i] = pending_[i + 1];
+    }
+}
+
+int SimpleUpdateLoop::select_source(long long now, unsigned *code)
+{
+    *code = 0;
+    // Exclusive sources take all slots.
+    int exclusive = -1;
+    for (unsigned i = 0; i < refreshSources_.size(); ++i)
+    {
+        if (refreshSources_[i].priority >= EXCLUSIVE_MIN_PRIORITY &&
+            (exclusive < 0 ||
+                refreshSources_[i].priority >
+                    refreshSources_[exclusive].priority))
+        {
+            exclusive = i;
+        }
+    }
+    if (exclusive >= 0)
+    {
+        for (unsigned i = 0; i < numPending_; ++i)
+        {
+            if (pending_[i].source == refreshSources_[exclusive].source)
+            {
+                *code = pending_[i].code;
+                erase_pending(i);
+                break;
+            }
+        }
+        return exclusive;
+    }
+
+    // Pending updates in the order of arrival.
+    for (unsigned i = 0; i < numPending_;)
+    {
+        int idx = find_source(pending_[i].source);
+        if (idx < 0)
+        {
+            // Not a refresh source, nothing to ask.
+            erase_pending(i);
+            continue;
+        }
+        if (now - refreshSources_[idx].lastRefresh >= MIN_SOURCE_GAP_NSEC)
+        {
+            *code = pending_[i].code;
+            erase_pending(i);
+            return idx;
+        }
+        ++i;
+    }
+
+    // Background refresh.
+    const long long max_age =
+        MSEC_TO_NSEC(config_dcc_max_refresh_interval_msec());
+    int overdue = -1;
+    long long overdue_age = 0;
+    int best = -1;
+    long long best_score = 0;
+    for (unsigned i = 0; i < refreshSources_.size(); ++i)
+    {
+        const RefreshEntry &e = refreshSources_[i];
+        long long age = now - e.lastRefresh;
+        if (age < MIN_SOURCE_GAP_NSEC)
+        {
+            continue;
+        }
+        if (age >= max_age)
+        {
+            if (overdue < 0 || age > overdue_age)
+            {
+                overdue = i;
+                overdue_age = age;
+            }
+            continue;
+        }
+        long long score = age * (1 + e.priority);
+        if (e.moving)
+        {
+            score *= MOVING_WEIGHT;
+        }
+        if (now - e.lastChange < RECENT_CHANGE_NSEC)
+        {
+            score *= RECENT_CHANGE_WEIGHT;
+        }
+        if (best < 0 || score > best_score)
+        {
+            best = i;
+            best_score = score;
+        }
+    }
+    return overdue >= 0 ? overdue : best;
+}
+
 StateFlowBase::Action SimpleUpdateLoop::entry()
 {
-    long long current_time = os_get_time_monotonic();
-    long long prev_cycle_start = lastCycleStart_;
-    if (nextRefreshIndex_ >= refreshSources_.size())
+    long long now = os_get_time_monotonic();
+    int idx;
+    unsigned code;
+    PacketSource *source = nullptr;
     {
-        nextRefreshIndex_ = 0;
-        lastCycleStart_ = current_time;
+        AtomicHolder h(this);
+        idx = select_source(now, &code);
+        if (idx >= 0)
+        {
+            refreshSources_[idx].lastRefresh = now;
+            source = refreshSources_[idx].source;
+        }
     }
-    if (nextRefreshIndex_ == 0 &&
-        (current_time - prev_cycle_start < MSEC_TO_NSEC(5) ||
-         refreshSources_.empty()))
+    if (!source)
     {
         // We do not want to send another packet to the same locomotive too
         // quick. We send an idle packet instead. OR: We do not have any
@@ -72,10 +251,15 @@ StateFlowBase::Action SimpleUpdateLoop::entry()
     }
     else
     {
-        // Send an update to the current loco.
-        refreshSources_[nextRefreshIndex_]
-            ->get_next_packet(0, message()->data());
-        nextRefreshIndex_++;
+        // Send an update to the chosen loco.
+        source->get_next_packet(code, message()->data());
+        bool moving = source->get_speed().speed() > 0;
+        AtomicHolder h(this);
+        if ((unsigned)idx < refreshSources_.size() &&
+            refreshSources_[idx].source == source)
+        {
+            refreshSources_[idx].moving = moving;
+        }
     }
     // We pass on the filled packet to the track processor.
     trackSend_->send(transfer_message());
@@ -40,13 +40,33 @@
 
 #include "dcc/UpdateLoop.hxx"
 #include "executor/StateFlow.hxx"
+#include "utils/constants.hxx"
+
+/// Longest time (in msec) a refresh source may go without a background
+/// refresh packet, as long as the track can fit every source into this period.
+DECLARE_CONST(dcc_max_refresh_interval_msec);
 
 namespace dcc
 {
 
-/// Implementation of a command station update loop. This loop iterates over
-/// all locomotive implementations and polls them for the next packet in a
-/// strict round-robin behavior (no prioritization).
+/// Implementation of a command station update loop. This loop polls the
+/// locomotive implementations for the next packet. Each packet slot is given
+/// to:
+///
+/// - the highest exclusive refresh source, if there is one (see
+///   UpdateLoopBase::EXCLUSIVE_MIN_PRIORITY);
+///
+/// - otherwise the oldest pending update from notify_update();
+///
+/// - otherwise the source that did not get a packet for the longest time
+///   beyond dcc_max_refresh_interval_msec;
+///
+/// - otherwise the source with the largest weighted age. The age is the time
+///   since the last packet to that source, weighted up for sources with a
+///   non-zero priority, for moving trains and for sources that changed
+///   recently.
+///
+/// The same source is not sent two packets within 5 msec.
 ///
 /// Usage:
 ///
@@ -67,42 +87,77 @@ public:
 
     /** Adds a new refresh source to the background refresh packets. */
     bool add_refresh_source(
-        dcc::PacketSource *source, unsigned priority) OVERRIDE
-    {
-        /// @todo implement priority refresh.
-        AtomicHolder h(this);
-        refreshSources_.push_back(source);
-        return true;
-    }
+        dcc::PacketSource *source, unsigned priority) OVERRIDE;
 
     /** Deletes a packet refresh source. */
-    void remove_refresh_source(dcc::PacketSource *source) OVERRIDE
-    {
-        AtomicHolder h(this);
-        refreshSources_.erase(
-            remove(refreshSources_.begin(), refreshSources_.end(), source),
-            refreshSources_.end());
-    }
-
-    /** We ignore notifications. The loop will get to them anyway. */
-    void notify_update(PacketSource *source, unsigned code) OVERRIDE
-    {
-    }
+    void remove_refresh_source(dcc::PacketSource *source) OVERRIDE;
+
+    /** Queues a high priority update packet for a source. */
+    void notify_update(PacketSource *source, unsigned code) OVERRIDE;
 
     // Entry to the state flow -- when a new packet needs to be sent.
     Action entry() OVERRIDE;
 
+    /// Minimum time between two packets to the same source.
+    static constexpr long long MIN_SOURCE_GAP_NSEC = MSEC_TO_NSEC(5);
+    /// A source counts as recently changed for this long after an update.
+    static constexpr long long RECENT_CHANGE_NSEC = SEC_TO_NSEC(5);
+    /// Multiplies the age of moving trains.
+    static constexpr unsigned MOVING_WEIGHT = 4;
+    /// Multiplies the age of recently changed sources.
+    static constexpr unsigned RECENT_CHANGE_WEIGHT = 4;
+    /// How many notify_update calls may be waiting for their packet slot.
+    static constexpr unsigned MAX_PENDING_UPDATES = 16;
+
 private:
+    /// Scheduling state of a refresh source.
+    struct RefreshEntry
+    {
+        /// Source to ask for packets.
+        dcc::PacketSource *source;
+        /// Priority from add_refresh_source.
+        unsigned priority;
+        /// true if the source was a moving train when it last got a packet.
+        bool moving;
+        /// os time when the source last got a packet.
+        long long lastRefresh;
+        /// os time of the last notify_update for this source.
+        long long lastChange;
+    };
+
+    /// An update requested via notify_update.
+    struct PendingUpdate
+    {
+        /// Source to ask for the packet.
+        dcc::PacketSource *source;
+        /// Code to pass to get_next_packet.
+        unsigned code;
+    };
+
+    /// Chooses the source for the next packet slot. Must be called with the
+    /// lock held.
+    /// @param now current os time.
+    /// @param code will be set to the code to pass to get_next_packet.
+    /// @return index in refreshSources_, or -1 to send an idle packet.
+    int select_source(long long now, unsigned *code);
+
+    /// @return index of source in refreshSources_ or -1 if not found. Must be
+    /// called with the lock held.
+    int find_source(dcc::PacketSource *source);
+
+    /// Removes an entry from pending_. Must be called with the lock held.
+    void erase_pending(unsigned idx);
+
     // Place where we forward the packets filled in.
     TrackIf *trackSend_;
 
     // Packet sources to ask about refreshing data periodically.
-    vector<dcc::PacketSource *> refreshSources_;
+    vector<RefreshEntry> refreshSources_;
 
-    /// Offset in the refreshSources_ vector for the next loco to send.
-    size_t nextRefreshIndex_;
-    /// os time for the last time we sent a packet for loco zero.
-    long long lastCycleStart_;
+    /// Updates waiting for a packet slot, in the order of arrival.
+    PendingUpdate pending_[MAX_PENDING_UPDATES];
+    /// Number of valid entries in pending_.
+    unsigned numPending_ {0};
 };
 }
 
@@ -35,3 +35,4 @@
 #include "utils/constants.hxx"
 
 DEFAULT_CONST(dcc_virtual_f0_offset, 100);
+DEFAULT_CONST(dcc_max_refresh_interval_msec, 1500);
@@ -35,6 +35,7 @@
 #ifndef _EXECUTOR_DISPATCHER_HXX_
 #define _EXECUTOR_DISPATCHER_HXX_
 
+#include <algorithm>
 #include <vector>
 
 #include "executor/Notifiable.hxx"
@@ -46,6 +47,14 @@
    invoked.
 
    Handlers are called in no particular order.
+
+   When the match condition is not negated, the handlers are looked up via an
+   index: registrations are grouped by mask, and each group is sorted by the
+   registered identifier bits. Matching a message costs one binary search per
+   distinct mask instead of a check against every registered handler. The
+   index is rebuilt lazily upon the first message after the registrations
+   changed. With only a few handlers registered a linear scan is faster, so
+   the index is only used above MIN_INDEXED_HANDLERS registrations.
  */
 template <int NUM_PRIO>
 class DispatchFlowBase : public UntypedStateFlow<QList<NUM_PRIO>>
@@ -181,12 +190,63 @@ protected:
         }
     };
 
+    /// One registration in the lookup index.
+    struct IndexEntry
+    {
+        ID id; ///< Registered bits, with the group's mask applied.
+        unsigned index; ///< Offset of the registration in handlers_.
+
+        /// Sort order within a MaskGroup. @param o other entry. @return true
+        /// if this entry sorts before o.
+        bool operator<(const IndexEntry &o) const
+        {
+            return id < o.id;
+        }
+    };
+
+    /// All registrations that share the same mask.
+    struct MaskGroup
+    {
+        ID mask; ///< Mask of all registrations in this group.
+        vector<IndexEntry> entries; ///< Registrations, sorted by id.
+    };
+
+    /// Below this many registrations the handlers are scanned linearly
+    /// instead of being looked up via the index.
+    static constexpr unsigned MIN_INDEXED_HANDLERS = 16;
+
+    /// Recomputes index_ from handlers_. Leaves index_ empty if the index
+    /// should not be used. Must be called with lock_ held.
+    void rebuild_index();
+
+    /// Fills in matches_ with the offsets of the handlers matching a given
+    /// identifier, in increasing order. Must be called with lock_ held.
+    /// @param id identifier of the incoming message.
+    void lookup_index(ID id);
+
     /// Registered handlers.
     vector<HandlerInfo> handlers_;
 
+    /// Lookup index of handlers_. Empty if the index is not used.
+    vector<MaskGroup> index_;
+
+    /// Offsets in handlers_ that matched the current message by the index.
+    vector<unsigned> matches_;
+
     /// Index of the next handler to look at.
     size_t currentIndex_;
 
+    /// Index of the next entry in matches_ to look at.
+    size_t currentMatch_{0};
+
+    /// true if handlers_ changed since index_ was computed.
+    bool indexDirty_{false};
+    /// true if the current message has not been looked up in the index yet.
+    bool lookupPending_{false};
+    /// true if the current message is dispatched via matches_, false if via
+    /// a linear scan of handlers_.
+    bool useIndex_{false};
+
     /// If non-NULL we still need to call this handler.
     UntypedHandler *lastHandlerToCall_{nullptr};
     /// Handler to give all messages that were not matched by any other handler
@@ -370,6 +430,7 @@ void DispatchFlowBase<NUM_PRIO>::register_handler(UntypedHandler *handler,
     handlers_[idx].handler = handler;
     handlers_[idx].id = id;
     handlers_[idx].mask = mask;
+    indexDirty_ = true;
 }
 
 template<int NUM_PRIO>
@@ -395,6 +456,7 @@ DispatchFlowBase<NUM_PRIO>::unregister_handler(UntypedHandler *handler,
     {
         handlers_.resize(handlers_.size() - 1);
     }
+    indexDirty_ = true;
 }
 
 template<int NUM_PRIO>
@@ -413,13 +475,77 @@ void DispatchFlowBase<NUM_PRIO>::unregister_handler_all(
     {
         handlers_.pop_back();
     }
+    indexDirty_ = true;
+}
+
+template<int NUM_PRIO>
+void DispatchFlowBase<NUM_PRIO>::rebuild_index()
+{
+    index_.clear();
+    indexDirty_ = false;
+    if (negateMatch_ || handlers_.size() < MIN_INDEXED_HANDLERS)
+    {
+        return;
+    }
+    for (unsigned i = 0; i < handlers_.size(); ++i)
+    {
+        auto &h = handlers_[i];
+        if (!h.handler)
+        {
+            continue;
+        }
+        MaskGroup *g = nullptr;
+        for (auto &gg : index_)
+        {
+            if (gg.mask == h.mask)
+            {
+                g = &gg;
+                break;
+            }
+        }
+        if (!g)
+        {
+            index_.emplace_back();
+            g = &index_.back();
+            g->mask = h.mask;
+        }
+        g->entries.push_back({h.id & h.mask, i});
+    }
+    for (auto &g : index_)
+    {
+        // Stable sort keeps the handlers with the same id in the order of
+        // their registration.
+        std::stable_sort(g.entries.begin(), g.entries.end());
+    }
+}
+
+template<int NUM_PRIO>
+void DispatchFlowBase<NUM_PRIO>::lookup_index(ID id)
+{
+    matches_.clear();
+    for (auto &g : index_)
+    {
+        IndexEntry key;
+        key.id = id & g.mask;
+        auto it = std::lower_bound(g.entries.begin(), g.entries.end(), key);
+        for (; it != g.entries.end() && it->id == key.id; ++it)
+        {
+            matches_.push_back(it->index);
+        }
+    }
+    if (index_.size() > 1)
+    {
+        std::sort(matches_.begin(), matches_.end());
+    }
 }
 
 template<int NUM_PRIO>
 StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::entry()
 {
     currentIndex_ = 0;
+    currentMatch_ = 0;
     lastHandlerToCall_ = nullptr;
+    lookupPending_ = true;
     return call_immediately(STATE(iterate));
 }
 
@@ -427,36 +553,80 @@ template<int NUM_PRIO>
 StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::iterate()
 {
     ID id = get_message_id();
+    bool done;
     {
         // @todo(balazs.racz) make the registered handlers structure for the
         // dispatcher lock-free. This mutex here is very expensive.
         OSMutexLock l(&lock_);
-        for (; currentIndex_ < handlers_.size(); ++currentIndex_)
+        if (lookupPending_)
         {
-            auto &h = handlers_[currentIndex_];
-            if (!h.handler)
+            lookupPending_ = false;
+            if (indexDirty_)
             {
-                continue;
+                rebuild_index();
             }
-            if (negateMatch_ && (id & h.mask) == (h.id & h.mask))
+            useIndex_ = !index_.empty();
+            if (useIndex_)
             {
-                continue;
+                lookup_index(id);
             }
-            if ((!negateMatch_) && (id & h.mask) != (h.id & h.mask))
+        }
+        if (!useIndex_)
+        {
+            for (; currentIndex_ < handlers_.size(); ++currentIndex_)
             {
-                continue;
+                auto &h = handlers_[currentIndex_];
+                if (!h.handler)
+                {
+                    continue;
+                }
+                if (negateMatch_ && (id & h.mask) == (h.id & h.mask))
+                {
+                    continue;
+                }
+                if ((!negateMatch_) && (id & h.mask) != (h.id & h.mask))
+                {
+                    continue;
+                }
+                // At this point: we have another handler.
+                if (!lastHandlerToCall_)
+                {
+                    // This was the first we found.
+                    lastHandlerToCall_ = h.handler;
+                    continue;
+                }
+                break;
             }
-            // At this point: we have another handler.
-            if (!lastHandlerToCall_)
+            done = currentIndex_ >= handlers_.size();
+        }
+        else
+        {
+            for (; currentMatch_ < matches_.size(); ++currentMatch_)
             {
-                // This was the first we found.
-                lastHandlerToCall_ = handlers_[currentIndex_].handler;
-                continue;
-            }            
-            break;
+                currentIndex_ = matches_[currentMatch_];
+                if (currentIndex_ >= handlers_.size())
+                {
+                    continue;
+                }
+                auto &h = handlers_[currentIndex_];
+                // The registrations might have changed since the lookup.
+                if (!h.handler || (id & h.mask) != (h.id & h.mask))
+                {
+                    continue;
+                }
+                // At this point: we have another handler.
+                if (!lastHandlerToCall_)
+                {
+                    // This was the first we found.
+                    lastHandlerToCall_ = h.handler;
+                    continue;
+                }
+                break;
+            }
+            done = currentMatch_ >= matches_.size();
         }
     }
-    if (currentIndex_ >= handlers_.size())
+    if (done)
     {
         return iteration_done();
     }
@@ -470,6 +640,7 @@ StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::clone_done()
 {
     lastHandlerToCall_ = handlers_[currentIndex_].handler;
     ++currentIndex_;
+    ++currentMatch_;
     return call_immediately(STATE(iterate));
 }
 
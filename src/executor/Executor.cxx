@@ -46,6 +46,12 @@
 #include <sys/select.h>
 #endif
 
+#if OPENMRN_HAVE_EPOLL
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#endif
+
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
 #endif
@@ -295,6 +301,12 @@ void *ExecutorBase::entry()
     started_ = 1;
     sequence_ = 0;
     selectHelper_.lock_to_thread();
+#if OPENMRN_HAVE_EPOLL
+    if (config_executor_use_epoll())
+    {
+        use_epoll();
+    }
+#endif
     /* wait for messages to process */
     for (; /* forever */;)
     {
@@ -331,6 +343,13 @@ void *ExecutorBase::entry()
 
 void ExecutorBase::select(Selectable *job)
 {
+#if OPENMRN_HAVE_EPOLL
+    if (epollFd_ >= 0)
+    {
+        epoll_select(job);
+        return;
+    }
+#endif
     fd_set *s = get_select_set(job->type());
     int fd = job->fd_;
     if (FD_ISSET(fd, s))
@@ -351,6 +370,13 @@ void ExecutorBase::select(Selectable *job)
 
 bool ExecutorBase::is_selected(Selectable *job)
 {
+#if OPENMRN_HAVE_EPOLL
+    if (epollFd_ >= 0)
+    {
+        return (unsigned)job->fd_ < epollSlots_.size() &&
+            epollSlots_[job->fd_].jobs[job->selectType_ - 1] != nullptr;
+    }
+#endif
     fd_set *s = get_select_set(job->type());
     int fd = job->fd_;
     return FD_ISSET(fd, s);
@@ -358,6 +384,13 @@ bool ExecutorBase::is_selected(Selectable *job)
 
 void ExecutorBase::unselect(Selectable *job)
 {
+#if OPENMRN_HAVE_EPOLL
+    if (epollFd_ >= 0)
+    {
+        epoll_unselect(job);
+        return;
+    }
+#endif
     fd_set *s = get_select_set(job->type());
     int fd = job->fd_;
     if (!FD_ISSET(fd, s))
@@ -383,6 +416,13 @@ void ExecutorBase::unselect(Selectable *job)
 
 void ExecutorBase::wait_with_select(long long wait_length)
 {
+#if OPENMRN_HAVE_EPOLL
+    if (epollFd_ >= 0)
+    {
+        wait_with_epoll(wait_length);
+        return;
+    }
+#endif
     fd_set fd_r(selectRead_);
     fd_set fd_w(selectWrite_);
     fd_set fd_x(selectExcept_);
@@ -425,6 +465,179 @@ void ExecutorBase::wait_with_select(long long wait_length)
     selectNFds_ = max_fd;
 }
 
+#if OPENMRN_HAVE_EPOLL
+
+/// @param type select type (READ, WRITE or EXCEPT).
+/// @return the epoll events that correspond to the select type.
+static uint32_t epoll_events(unsigned type)
+{
+    switch (type)
+    {
+        case Selectable::READ:
+            return EPOLLIN;
+        case Selectable::WRITE:
+            return EPOLLOUT;
+        case Selectable::EXCEPT:
+            return EPOLLPRI;
+    }
+    return 0;
+}
+
+void ExecutorBase::use_epoll()
+{
+    if (epollFd_ >= 0)
+    {
+        return;
+    }
+    HASSERT(selectables_.empty());
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    HASSERT(epollFd_ >= 0);
+}
+
+void ExecutorBase::epoll_select(Selectable *job)
+{
+    unsigned fd = job->fd_;
+    if (fd >= epollSlots_.size())
+    {
+        epollSlots_.resize(fd + 1);
+    }
+    Selectable *&slot = epollSlots_[fd].jobs[job->selectType_ - 1];
+    if (slot)
+    {
+        LOG(FATAL,
+            "Multiple Selectables are waiting for the same fd %d type %u", fd,
+            job->selectType_);
+    }
+    HASSERT(!job->next);
+    slot = job;
+    epoll_update(fd);
+}
+
+void ExecutorBase::epoll_unselect(Selectable *job)
+{
+    unsigned fd = job->fd_;
+    if (fd >= epollSlots_.size() ||
+        epollSlots_[fd].jobs[job->selectType_ - 1] != job)
+    {
+        LOG(FATAL, "Tried to remove a non-active selectable: fd %d type %u", fd,
+            job->selectType_);
+    }
+    epollSlots_[fd].jobs[job->selectType_ - 1] = nullptr;
+    epoll_update(fd);
+}
+
+void ExecutorBase::epoll_update(int fd)
+{
+    EpollSlot &s = epollSlots_[fd];
+    uint32_t want = 0;
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        if (s.jobs[i])
+        {
+            want |= epoll_events(i + 1);
+        }
+    }
+    if (want == s.events)
+    {
+        return;
+    }
+    // The fd stays registered; without waiting jobs it is only disarmed. It
+    // is registered with EPOLLONESHOT, so that the kernel disarms it when it
+    // reports an event, and the fd is not reported again until a job waits
+    // on it.
+    struct epoll_event ev;
+    ev.events = want | EPOLLONESHOT;
+    ev.data.fd = fd;
+    int op = s.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    int ret = ::epoll_ctl(epollFd_, op, fd, &ev);
+    if (ret < 0 && errno == ENOENT)
+    {
+        // The fd was closed and reopened since we last registered it.
+        ret = ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
+    }
+    else if (ret < 0 && errno == EEXIST)
+    {
+        ret = ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);
+    }
+    if (ret == 0)
+    {
+        s.events = want;
+        s.registered = true;
+        return;
+    }
+    s.registered = false;
+    if (!want)
+    {
+        // The fd was closed in the meantime, which is fine.
+        s.events = 0;
+        return;
+    }
+    // EPERM means a regular file, which select() would report as always
+    // ready. For bad fds we also wake up the jobs, which will then see the
+    // error in their read or write call.
+    if (errno != EPERM)
+    {
+        LOG(WARNING, "epoll_ctl failed for fd %d: %s", fd, strerror(errno));
+    }
+    s.events = 0;
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        if (s.jobs[i])
+        {
+            add(s.jobs[i]->wakeup_, s.jobs[i]->priority_);
+            s.jobs[i] = nullptr;
+        }
+    }
+}
+
+void ExecutorBase::wait_with_epoll(long long wait_length)
+{
+    /// How many events we take from the kernel in one call.
+    static constexpr int EPOLL_BATCH = 32;
+    struct epoll_event events[EPOLL_BATCH];
+    // See wait_with_select().
+    selectHelper_.clear_wakeup();
+    if (!empty())
+    {
+        wait_length = 0;
+    }
+    long long max_sleep = MSEC_TO_NSEC(config_executor_max_sleep_msec());
+    if (wait_length > max_sleep)
+    {
+        wait_length = max_sleep;
+    }
+    int ret =
+        selectHelper_.epoll_wait(epollFd_, events, EPOLL_BATCH, wait_length);
+    for (int i = 0; i < ret; ++i)
+    {
+        unsigned fd = events[i].data.fd;
+        uint32_t ev = events[i].events;
+        if (fd >= epollSlots_.size())
+        {
+            continue;
+        }
+        EpollSlot &s = epollSlots_[fd];
+        // EPOLLONESHOT disarmed the fd in the kernel.
+        s.events = 0;
+        for (unsigned j = 0; j < 3; ++j)
+        {
+            Selectable *job = s.jobs[j];
+            if (job && (ev & (epoll_events(j + 1) | EPOLLERR | EPOLLHUP)))
+            {
+                add(job->wakeup_, job->priority_);
+                s.jobs[j] = nullptr;
+            }
+        }
+        // Re-arms the fd for the jobs that did not get an event. When the
+        // woken up jobs select again, only the event mask is modified. If a
+        // flow closes the fd in the meantime, and a new fd gets the same
+        // number, the modify fails with ENOENT and we add the new fd.
+        epoll_update(fd);
+    }
+}
+
+#endif // OPENMRN_HAVE_EPOLL
+
 #endif
 
 #if defined(ARDUINO)
@@ -458,4 +671,10 @@ ExecutorBase::~ExecutorBase()
     {
         shutdown();
     }
+#if OPENMRN_HAVE_EPOLL
+    if (epollFd_ >= 0)
+    {
+        ::close(epollFd_);
+    }
+#endif
 }
@@ -38,6 +38,7 @@
 
 #include <functional>
 #include <atomic>
+#include <vector>
 
 #include "executor/Executable.hxx"
 #include "executor/Notifiable.hxx"
@@ -106,7 +107,7 @@ public:
      *
      * @param job is a Selectable pointer that is not currently watched.
      */
-    void select(Selectable* job);
+    virtual void select(Selectable* job);
 
     /** @return true if the given job's FD is currently enqueued for a
      * select. This may or may not mean that the specific job is waiting for a
@@ -125,7 +126,19 @@ public:
      *
      * @param job is a Selectable pointer that was previously inserted.
      */
-    void unselect(Selectable* job);
+    virtual void unselect(Selectable* job);
+
+#if OPENMRN_HAVE_EPOLL
+    /** Switches this executor to use epoll instead of select() for waiting
+     * on the file descriptors. This removes the FD_SETSIZE limit and makes
+     * the cost of a wakeup proportional to the number of ready FDs instead
+     * of the largest FD number. Called automatically when the constant
+     * executor_use_epoll is set.
+     *
+     * Must be called on the executor thread, when no Selectable is waiting.
+     */
+    void use_epoll();
+#endif
 
     /** Performs one loop of the execution on the calling thread. @return true
      * if there is more scheduled work to do. Returns false if the executor
@@ -230,6 +243,36 @@ private:
     /** Head of the linked list for the select calls. */
     TypedQueue<Selectable> selectables_;
 
+#if OPENMRN_HAVE_EPOLL
+    /// Selectables waiting on a given fd when using epoll.
+    struct EpollSlot
+    {
+        /// Waiting Selectable for each select type (READ, WRITE, EXCEPT).
+        Selectable *jobs[3] {nullptr, nullptr, nullptr};
+        /// Event mask armed in the kernel. 0 if the fd is not registered,
+        /// or is disarmed after a wakeup (EPOLLONESHOT).
+        uint32_t events {0};
+        /// True if the fd is (as far as we know) in the epoll set.
+        bool registered {false};
+    };
+
+    /// epoll version of select(). @param job to add.
+    void epoll_select(Selectable *job);
+    /// epoll version of unselect(). @param job to remove.
+    void epoll_unselect(Selectable *job);
+    /// Updates the kernel's event mask for an fd to match the waiting jobs.
+    /// @param fd file descriptor.
+    void epoll_update(int fd);
+    /// epoll version of wait_with_select(). @param wait_length max nsec to
+    /// sleep.
+    void wait_with_epoll(long long wait_length);
+
+    /// The epoll instance, or -1 when using select().
+    int epollFd_ {-1};
+    /// Indexed by fd.
+    std::vector<EpollSlot> epollSlots_;
+#endif
+
     /** Set to 1 when the executor thread has exited and it is safe to delete
      * *this. */
     std::atomic_uint_least8_t done_;
@@ -261,7 +304,11 @@ public:
 /// Implementation the ExecutorBase with a specific number of priority
 /// bands. The memory usage and scheduling cost is proportional to the number
 /// of priority bands, so it should be kept pretty low.
-template <unsigned NUM_PRIO>
+///
+/// The QUEUE template argument selects the input queue. The default takes a
+/// lock on every add() call. Executors that many threads add to can use
+/// QListMpsc<NUM_PRIO> instead, which is lock-free for the adding threads.
+template <unsigned NUM_PRIO, class QUEUE = QListProtected<NUM_PRIO>>
 class Executor : public ExecutorBase
 {
 public:
@@ -373,7 +420,7 @@ private:
     DISALLOW_COPY_AND_ASSIGN(Executor);
 
     /// Internal queue of executables waiting to be scheduled.
-    QListProtected<NUM_PRIO> queue_;
+    QUEUE queue_;
 };
 
 /** This class can be given an executor, and will notify itself when that
@@ -406,9 +453,9 @@ private:
     ExecutorBase* executor_;
 };
 
-template <unsigned NUM_PRIO>
+template <unsigned NUM_PRIO, class QUEUE>
 /** Destructs the executor. Waits for the executor to run out of work first. */
-Executor<NUM_PRIO>::~Executor()
+Executor<NUM_PRIO, QUEUE>::~Executor()
 {
     shutdown();
 }
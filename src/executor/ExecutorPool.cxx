@@ -0,0 +1,306 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file ExecutorPool.cxx
+ *
+ * Runs many executors on a fixed number of worker threads with work
+ * stealing.
+ *
+ * @author agent
+ * @date 17 Oct 2026
+ */
+
+
+#include "executor/ExecutorPool.hxx"
+
+#include <algorithm>
+
+/// Groups that have no timers wake up this often anyway. Same as the
+/// Executor's default.
+static constexpr long long MAX_SLEEP_NSEC = SEC_TO_NSEC(3600);
+
+PoolExecutorBase::PoolExecutorBase(ExecutorPool *pool)
+    : pool_(pool)
+{
+    pool_->add_group(this);
+}
+
+PoolExecutorBase::~PoolExecutorBase()
+{
+    stop();
+}
+
+void PoolExecutorBase::stop()
+{
+    pool_->remove_group(this);
+    // Waits for a worker that might still be finishing with this group.
+    OSSem sem;
+    {
+        OSMutexLock h(&stopLock_);
+        if (!scheduled_ && !running_)
+        {
+            return;
+        }
+        stopSem_ = &sem;
+    }
+    sem.wait();
+    // Makes sure the worker is out of release().
+    OSMutexLock h(&stopLock_);
+    stopSem_ = nullptr;
+}
+
+void PoolExecutorBase::release()
+{
+    OSMutexLock h(&stopLock_);
+    running_ = false;
+    if (stopSem_ && !scheduled_)
+    {
+        stopSem_->post();
+    }
+}
+
+void PoolExecutorBase::schedule()
+{
+    if (!scheduled_.exchange(true))
+    {
+        pool_->enqueue(this);
+    }
+}
+
+ExecutorPool::ExecutorPool(
+    const char *name, unsigned num_threads, int priority, size_t stack_size)
+    : wakeup_(0)
+    , exited_(0)
+{
+    HASSERT(num_threads > 0);
+    for (unsigned i = 0; i < num_threads; ++i)
+    {
+        workers_.emplace_back(new Worker(this, i));
+    }
+    for (auto &w : workers_)
+    {
+        w->start(name, priority, stack_size);
+    }
+}
+
+ExecutorPool::~ExecutorPool()
+{
+    shutdown_ = true;
+    // Each worker takes at most one post before it sees shutdown_.
+    for (unsigned i = 0; i < workers_.size(); ++i)
+    {
+        wakeup_.post();
+    }
+    for (unsigned i = 0; i < workers_.size(); ++i)
+    {
+        exited_.wait();
+    }
+    HASSERT(groups_.empty());
+}
+
+void *ExecutorPool::Worker::entry()
+{
+    pool_->worker_loop(this);
+    return nullptr;
+}
+
+void ExecutorPool::add_group(PoolExecutorBase *g)
+{
+    OSMutexLock h(&groupsLock_);
+    groups_.push_back(g);
+}
+
+void ExecutorPool::remove_group(PoolExecutorBase *g)
+{
+    OSMutexLock h(&groupsLock_);
+    groups_.erase(std::remove(groups_.begin(), groups_.end(), g),
+                  groups_.end());
+}
+
+void ExecutorPool::enqueue(PoolExecutorBase *g)
+{
+    // Prefers the queue of the calling worker, which keeps the data in its
+    // cache. Other workers will steal if they run out of work.
+    os_thread_t self = os_thread_self();
+    Worker *w = nullptr;
+    for (auto &ww : workers_)
+    {
+        if (ww->get_handle() == self)
+        {
+            w = ww.get();
+            break;
+        }
+    }
+    if (!w)
+    {
+        w = workers_[nextWorker_.fetch_add(1) % workers_.size()].get();
+    }
+    {
+        OSMutexLock h(&w->lock_);
+        w->runQueue_.push_back(g);
+    }
+    if (numIdle_.load())
+    {
+        wakeup_.post();
+    }
+}
+
+PoolExecutorBase *ExecutorPool::dequeue(Worker *w)
+{
+    {
+        OSMutexLock h(&w->lock_);
+        if (!w->runQueue_.empty())
+        {
+            PoolExecutorBase *g = w->runQueue_.front();
+            w->runQueue_.pop_front();
+            return g;
+        }
+    }
+    for (unsigned i = 1; i < workers_.size(); ++i)
+    {
+        Worker *victim = workers_[(w->index_ + i) % workers_.size()].get();
+        OSMutexLock h(&victim->lock_);
+        if (!victim->runQueue_.empty())
+        {
+            PoolExecutorBase *g = victim->runQueue_.back();
+            victim->runQueue_.pop_back();
+            return g;
+        }
+    }
+    return nullptr;
+}
+
+void ExecutorPool::run_group(Worker *w, PoolExecutorBase *g)
+{
+    g->running_ = true;
+    long long wait = g->loop_some();
+    if (wait == 0)
+    {
+        // More work is pending. Goes to the back of the queue to let other
+        // groups run too.
+        {
+            OSMutexLock h(&w->lock_);
+            w->runQueue_.push_back(g);
+        }
+        g->release();
+        return;
+    }
+    long long wakeup = INT64_MAX;
+    if (wait < MAX_SLEEP_NSEC)
+    {
+        wakeup = os_get_time_monotonic() + wait;
+    }
+    g->nextWakeup_ = wakeup;
+    long long check = nextTimerCheck_.load();
+    while (wakeup < check &&
+           !nextTimerCheck_.compare_exchange_weak(check, wakeup))
+    {
+    }
+    g->scheduled_ = false;
+    // An add() might have come in after loop_some() saw the queue empty,
+    // but before we cleared the scheduled_ bit. Similarly check_timers() may
+    // have consumed our wakeup while the schedule() call was still a no-op.
+    if (!g->empty() || g->nextWakeup_.load() != wakeup)
+    {
+        g->schedule();
+    }
+    // This has to be the last access to *g, because the owner may destroy
+    // the group as soon as it is released.
+    g->release();
+}
+
+long long ExecutorPool::check_timers()
+{
+    long long now = os_get_time_monotonic();
+    long long next = INT64_MAX;
+    nextTimerCheck_ = INT64_MAX;
+    OSMutexLock h(&groupsLock_);
+    for (PoolExecutorBase *g : groups_)
+    {
+        long long t = g->nextWakeup_.load();
+        // A worker may store a fresh wakeup concurrently; that must not be
+        // overwritten.
+        while (t <= now &&
+               !g->nextWakeup_.compare_exchange_weak(t, INT64_MAX))
+        {
+        }
+        if (t <= now)
+        {
+            g->schedule();
+        }
+        else if (t < next)
+        {
+            next = t;
+        }
+    }
+    long long check = nextTimerCheck_.load();
+    while (next < check && !nextTimerCheck_.compare_exchange_weak(check, next))
+    {
+    }
+    return nextTimerCheck_.load();
+}
+
+void ExecutorPool::worker_loop(Worker *w)
+{
+    while (!shutdown_)
+    {
+        if (os_get_time_monotonic() >= nextTimerCheck_.load())
+        {
+            check_timers();
+        }
+        PoolExecutorBase *g = dequeue(w);
+        if (g)
+        {
+            run_group(w, g);
+            continue;
+        }
+        // Goes to sleep. The idle count has to be visible before the queues
+        // are checked again, otherwise a wakeup could be missed.
+        numIdle_.fetch_add(1);
+        g = dequeue(w);
+        if (g)
+        {
+            numIdle_.fetch_sub(1);
+            run_group(w, g);
+            continue;
+        }
+        long long timeout = nextTimerCheck_.load();
+        if (timeout != INT64_MAX)
+        {
+            timeout -= os_get_time_monotonic();
+        }
+        if (timeout > MAX_SLEEP_NSEC)
+        {
+            timeout = MAX_SLEEP_NSEC;
+        }
+        if (timeout > 0)
+        {
+            wakeup_.timedwait(timeout);
+        }
+        numIdle_.fetch_sub(1);
+    }
+    exited_.post();
+}
@@ -0,0 +1,268 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file ExecutorPool.hxx
+ *
+ * Runs many executors on a fixed number of worker threads with work
+ * stealing.
+ *
+ * @author agent
+ * @date 17 Oct 2026
+ */
+
+#ifndef _EXECUTOR_EXECUTORPOOL_HXX_
+#define _EXECUTOR_EXECUTORPOOL_HXX_
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "executor/Executor.hxx"
+#include "os/OS.hxx"
+
+class ExecutorPool;
+
+/// An affinity group of an ExecutorPool. This is an ExecutorBase that does
+/// not have a thread of its own; instead the worker threads of the pool take
+/// turns running it. The executables of one group never run concurrently, so
+/// all flows of a Service that is bound to the group can share state just
+/// like on a regular Executor. Different groups run in parallel.
+///
+/// Timers work as usual. select() is not supported (calling it crashes);
+/// flows that wait on file descriptors have to stay on a regular Executor.
+class PoolExecutorBase : public ExecutorBase
+{
+public:
+    /// Constructor. @param pool is the pool whose threads will run this
+    /// group. Must outlive *this.
+    PoolExecutorBase(ExecutorPool *pool);
+
+    /// Destructor. The group must be idle.
+    ~PoolExecutorBase();
+
+#if OPENMRN_FEATURE_RTOS_FROM_ISR
+    void add_from_isr(Executable *action, unsigned priority = UINT_MAX) override
+    {
+        DIE("ExecutorPool does not support add_from_isr");
+    }
+#endif // OPENMRN_FEATURE_RTOS_FROM_ISR
+
+    void select(Selectable *job) override
+    {
+        DIE("ExecutorPool does not support select");
+    }
+
+    void unselect(Selectable *job) override
+    {
+        DIE("ExecutorPool does not support select");
+    }
+
+protected:
+    /// Puts *this on the pool's run queue if it is not there yet. Has to be
+    /// called after every add.
+    void schedule();
+
+    /// Unregisters from the pool and waits until no worker is running *this
+    /// anymore. Called from the destructors.
+    void stop();
+
+    /// Called by the worker as the last access to *this after running it.
+    /// Wakes up stop() if it is waiting.
+    void release();
+
+private:
+    friend class ExecutorPool;
+
+    /// Parent pool.
+    ExecutorPool *pool_;
+    /// Absolute time (nsec) when the earliest timer of this group expires,
+    /// INT64_MAX if none.
+    std::atomic<long long> nextWakeup_ {INT64_MAX};
+    /// true if *this is on a run queue of the pool or being run by a worker.
+    std::atomic<bool> scheduled_ {false};
+    /// true while a worker is running *this or is about to release it.
+    std::atomic<bool> running_ {false};
+    /// Protects stopSem_, and serializes release() with stop().
+    OSMutex stopLock_;
+    /// Posted when a worker releases *this while stop() is waiting.
+    OSSem *stopSem_ {nullptr};
+};
+
+/// Affinity group of an ExecutorPool with a specific number of priority
+/// bands. See @ref PoolExecutorBase.
+template <unsigned NUM_PRIO> class PoolExecutor : public PoolExecutorBase
+{
+public:
+    /// Constructor. @param pool is the pool whose threads will run this
+    /// group.
+    PoolExecutor(ExecutorPool *pool)
+        : PoolExecutorBase(pool)
+    {
+    }
+
+    ~PoolExecutor()
+    {
+        stop();
+    }
+
+    void add(Executable *msg, unsigned priority = UINT_MAX) override
+    {
+        queue_.insert(msg, priority >= NUM_PRIO ? NUM_PRIO - 1 : priority);
+        schedule();
+    }
+
+    bool empty() override
+    {
+        return queue_.empty();
+    }
+
+    uint32_t sequence() override
+    {
+        return sequence_;
+    }
+
+private:
+    Executable *next(unsigned *priority) override
+    {
+        auto result = queue_.next();
+        *priority = result.index;
+        if (result.item)
+        {
+            ++sequence_;
+        }
+        return static_cast<Executable *>(result.item);
+    }
+
+    /// Executables waiting to be run.
+    QListProtected<NUM_PRIO> queue_;
+};
+
+/// A fixed set of worker threads that run any number of PoolExecutors
+/// (affinity groups). Services opt in by being created with a PoolExecutor
+/// instead of a regular Executor. This allows a Linux gateway to use more
+/// than one core, while each group keeps the single-threaded semantics.
+///
+/// Each worker has its own run queue of groups; a worker that runs out of
+/// work steals groups from the back of the other workers' queues.
+class ExecutorPool
+{
+public:
+    /// Constructor. Starts the worker threads.
+    /// @param name prefix of the thread names.
+    /// @param num_threads how many worker threads to start.
+    /// @param priority thread priority (0 == default prio).
+    /// @param stack_size thread stack size, ignored on Linux.
+    ExecutorPool(const char *name, unsigned num_threads, int priority = 0,
+                 size_t stack_size = 2048);
+
+    /// Destructor. Stops the worker threads. All groups have to be destroyed
+    /// before.
+    ~ExecutorPool();
+
+    /// @return the number of worker threads.
+    unsigned size()
+    {
+        return workers_.size();
+    }
+
+private:
+    friend class PoolExecutorBase;
+
+    /// One worker thread with its run queue.
+    class Worker : public OSThread
+    {
+    public:
+        /// Constructor. @param pool parent. @param index of this worker.
+        Worker(ExecutorPool *pool, unsigned index)
+            : pool_(pool)
+            , index_(index)
+        {
+        }
+
+        /// Thread body.
+        void *entry() override;
+
+        /// Parent.
+        ExecutorPool *pool_;
+        /// Index in the parent's workers_ vector.
+        unsigned index_;
+        /// Protects runQueue_.
+        OSMutex lock_;
+        /// Groups that are ready to run.
+        std::deque<PoolExecutorBase *> runQueue_;
+    };
+
+    /// Adds a group to the run queue of a worker. @param g the group; must
+    /// be already marked as scheduled.
+    void enqueue(PoolExecutorBase *g);
+
+    /// Takes a group from a worker's own queue, or steals from another
+    /// worker. @param w the worker looking for work. @return group to run or
+    /// nullptr.
+    PoolExecutorBase *dequeue(Worker *w);
+
+    /// Runs a few executables of a group, then puts it back to the run queue
+    /// if it has more work. @param w worker running it. @param g group to
+    /// run.
+    void run_group(Worker *w, PoolExecutorBase *g);
+
+    /// Schedules the groups whose timers are due. @return absolute time of
+    /// the next timer check.
+    long long check_timers();
+
+    /// Main loop of a worker thread. @param w the worker.
+    void worker_loop(Worker *w);
+
+    /// Registers a group. @param g group.
+    void add_group(PoolExecutorBase *g);
+
+    /// Unregisters a group. @param g group.
+    void remove_group(PoolExecutorBase *g);
+
+    /// Worker threads.
+    std::vector<std::unique_ptr<Worker>> workers_;
+    /// Protects groups_.
+    OSMutex groupsLock_;
+    /// All registered groups, for the timer checks.
+    std::vector<PoolExecutorBase *> groups_;
+    /// Earliest time when any group's timer may expire.
+    std::atomic<long long> nextTimerCheck_ {INT64_MAX};
+    /// Idle workers wait on this semaphore.
+    OSSem wakeup_;
+    /// Number of workers waiting on wakeup_.
+    std::atomic<unsigned> numIdle_ {0};
+    /// Round-robin counter for groups scheduled from outside the pool.
+    std::atomic<unsigned> nextWorker_ {0};
+    /// Posted by each worker when it exits.
+    OSSem exited_;
+    /// Set to true to stop the workers.
+    std::atomic<bool> shutdown_ {false};
+
+    DISALLOW_COPY_AND_ASSIGN(ExecutorPool);
+};
+
+#endif // _EXECUTOR_EXECUTORPOOL_HXX_
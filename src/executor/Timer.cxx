@@ -33,6 +33,9 @@
  */
 
 #include "executor/Timer.hxx"
+
+#include <algorithm>
+
 #include "executor/Executor.hxx"
 #include "os/os.h"
 
@@ -85,6 +88,11 @@ long long ActiveTimers::get_next_timeout()
 {
     OSMutexLock l(&lock_);
 
+    if (wheel_)
+    {
+        return wheel_next_timeout_locked(OSTime::get_monotonic());
+    }
+
     QMember **last = &activeTimers_.next;
     Timer *current_timer = static_cast<Timer *>(*last);
     long long now = OSTime::get_monotonic();
@@ -124,6 +132,11 @@ long long ActiveTimers::get_next_timeout()
 bool ActiveTimers::empty() {
     OSMutexLock l(&lock_);
 
+    if (wheel_)
+    {
+        return wheel_->count == 0;
+    }
+
     QMember **last = &activeTimers_.next;
     Timer *current_timer = static_cast<Timer *>(*last);
     return (current_timer == nullptr);
@@ -140,6 +153,14 @@ void ActiveTimers::insert_locked(Timer *timer)
     HASSERT(timer);
     HASSERT(timer->next == nullptr);
 
+    if (wheel_)
+    {
+        wheel_link_locked(timer);
+        ++wheel_->count;
+        notify();
+        return;
+    }
+
     QMember **last = &activeTimers_.next;
     Timer *current_timer = static_cast<Timer *>(*last);
     while (current_timer && current_timer->when_ <= timer->when_)
@@ -159,6 +180,12 @@ void ActiveTimers::insert_locked(Timer *timer)
 void ActiveTimers::remove_locked(Timer *timer)
 {
     HASSERT(timer);
+    if (wheel_)
+    {
+        wheel_unlink_locked(timer);
+        --wheel_->count;
+        return;
+    }
     // Removes the timer from the queue.
     QMember **last = &activeTimers_.next;
     while (*last && *last != timer)
@@ -185,3 +212,205 @@ void ActiveTimers::remove_timer(Timer *timer)
     remove_locked(timer);
     timer->isActive_ = 0;
 }
+
+void ActiveTimers::use_timing_wheel(unsigned tick_shift)
+{
+    OSMutexLock l(&lock_);
+    HASSERT(!wheel_);
+    HASSERT(activeTimers_.next == nullptr);
+    wheel_.reset(new Wheel());
+    tickShift_ = tick_shift;
+    wheel_->tick = OSTime::get_monotonic() >> tickShift_;
+}
+
+void ActiveTimers::wheel_link_locked(Timer *timer)
+{
+    Wheel &w = *wheel_;
+    long long tick = timer->when_ >> tickShift_;
+    if (tick < w.tick)
+    {
+        tick = w.tick;
+    }
+    long long delta = tick - w.tick;
+    QMember **head;
+    if (delta < WHEEL_SLOTS)
+    {
+        unsigned slot = tick & (WHEEL_SLOTS - 1);
+        head = &w.fine[slot];
+        w.fineBits[slot / 32] |= 1u << (slot % 32);
+    }
+    else if (delta < WHEEL_SLOTS * WHEEL_COARSE_SLOTS)
+    {
+        head = &w.coarse[(tick / WHEEL_SLOTS) & (WHEEL_COARSE_SLOTS - 1)];
+    }
+    else
+    {
+        head = &w.overflow;
+    }
+    timer->next = *head;
+    if (timer->next)
+    {
+        static_cast<Timer *>(timer->next)->wheelLink_ = &timer->next;
+    }
+    *head = timer;
+    timer->wheelLink_ = head;
+}
+
+void ActiveTimers::wheel_unlink_locked(Timer *timer)
+{
+    Wheel &w = *wheel_;
+    HASSERT(timer->wheelLink_ && *timer->wheelLink_ == timer);
+    QMember **link = timer->wheelLink_;
+    *link = timer->next;
+    if (timer->next)
+    {
+        static_cast<Timer *>(timer->next)->wheelLink_ = link;
+    }
+    timer->next = nullptr;
+    timer->wheelLink_ = nullptr;
+    if (!*link && link >= &w.fine[0] && link < &w.fine[WHEEL_SLOTS])
+    {
+        unsigned slot = link - &w.fine[0];
+        w.fineBits[slot / 32] &= ~(1u << (slot % 32));
+    }
+}
+
+void ActiveTimers::wheel_cascade_locked()
+{
+    Wheel &w = *wheel_;
+    long long block = w.tick / WHEEL_SLOTS;
+    QMember *list = nullptr;
+    if ((block & (WHEEL_COARSE_SLOTS - 1)) == 0)
+    {
+        list = w.overflow;
+        w.overflow = nullptr;
+    }
+    // The overflow list has to be relinked first, because some of its
+    // entries may belong to the coarse slot being cascaded.
+    for (int i = 0; i < 2; ++i)
+    {
+        while (list)
+        {
+            Timer *t = static_cast<Timer *>(list);
+            list = t->next;
+            t->next = nullptr;
+            wheel_link_locked(t);
+        }
+        QMember **coarse = &w.coarse[block & (WHEEL_COARSE_SLOTS - 1)];
+        list = *coarse;
+        *coarse = nullptr;
+    }
+}
+
+unsigned ActiveTimers::wheel_next_slot_locked(unsigned slot)
+{
+    Wheel &w = *wheel_;
+    while (slot < WHEEL_SLOTS)
+    {
+        uint32_t bits = w.fineBits[slot / 32] >> (slot % 32);
+        if (bits)
+        {
+            return slot + __builtin_ctz(bits);
+        }
+        slot = (slot / 32 + 1) * 32;
+    }
+    return WHEEL_SLOTS;
+}
+
+long long ActiveTimers::wheel_next_timeout_locked(long long now)
+{
+    Wheel &w = *wheel_;
+    long long now_tick = now >> tickShift_;
+    bool found_timer = false;
+    while (true)
+    {
+        // Expires the timers of the current tick. If the current tick is in
+        // the past, this is all the timers in the slot.
+        unsigned slot = w.tick & (WHEEL_SLOTS - 1);
+        QMember *current = w.fine[slot];
+        while (current)
+        {
+            Timer *t = static_cast<Timer *>(current);
+            current = t->next;
+            if (t->when_ > now)
+            {
+                continue;
+            }
+            wheel_unlink_locked(t);
+            --w.count;
+            found_timer = true;
+            t->isActive_ = 0;
+            t->isExpired_ = 1;
+            executor_->add(t, t->priority_);
+        }
+        if (w.tick >= now_tick)
+        {
+            break;
+        }
+        if (!w.count)
+        {
+            w.tick = now_tick;
+            break;
+        }
+        // Advances to the next tick with timers, but stops at the coarse
+        // slot boundary to cascade.
+        long long block_end = (w.tick | (WHEEL_SLOTS - 1)) + 1;
+        long long next = block_end - WHEEL_SLOTS +
+            wheel_next_slot_locked((w.tick & (WHEEL_SLOTS - 1)) + 1);
+        if (next > now_tick)
+        {
+            w.tick = now_tick;
+            continue;
+        }
+        w.tick = next;
+        if (next == block_end)
+        {
+            wheel_cascade_locked();
+        }
+    }
+
+    if (found_timer)
+    {
+        return 0;
+    }
+    if (!w.count)
+    {
+        // Wakes up the timer service every now and then. It won't make any
+        // difference.
+        return SEC_TO_NSEC(3600);
+    }
+    QMember *list = w.fine[w.tick & (WHEEL_SLOTS - 1)];
+    long long block_end = (w.tick | (WHEEL_SLOTS - 1)) + 1;
+    if (!list)
+    {
+        unsigned slot =
+            wheel_next_slot_locked((w.tick & (WHEEL_SLOTS - 1)) + 1);
+        if (slot < WHEEL_SLOTS)
+        {
+            list = w.fine[slot];
+        }
+    }
+    unsigned next_block = (block_end / WHEEL_SLOTS) & (WHEEL_COARSE_SLOTS - 1);
+    if (!list && !w.coarse[next_block] && (next_block || !w.overflow))
+    {
+        // Nothing will be cascaded at the block boundary, so the earliest
+        // timer is on a fine slot that wrapped around into the next block.
+        unsigned slot = wheel_next_slot_locked(0);
+        if (slot < WHEEL_SLOTS)
+        {
+            list = w.fine[slot];
+        }
+    }
+    if (!list)
+    {
+        // Nothing more in this block. Wakes up at the block boundary to
+        // cascade the timers from the coarse level.
+        return (block_end << tickShift_) - now;
+    }
+    long long first = INT64_MAX;
+    for (; list; list = list->next)
+    {
+        first = std::min(first, static_cast<Timer *>(list)->when_);
+    }
+    return first - now;
+}
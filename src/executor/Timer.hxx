@@ -35,6 +35,8 @@
 #ifndef _EXECUTOR_TIMER_HXX_
 #define _EXECUTOR_TIMER_HXX_
 
+#include <memory>
+
 #include "executor/Notifiable.hxx"
 #include "utils/Buffer.hxx"
 #include "utils/QMember.hxx"
@@ -44,7 +46,12 @@ class Timer;
 class ExecutorBase;
 
 /** Class that manages the list of active timers. The Executor uses this class
- * tightly in its sleep-execute loop. */
+ * tightly in its sleep-execute loop.
+ *
+ * By default the timers are kept in a list sorted by expiration time, which
+ * makes scheduling, updating and removing a timer O(n). Executors with many
+ * concurrent timers can switch to a hierarchical timing wheel instead by
+ * calling use_timing_wheel(), which makes these operations O(1) amortized. */
 class ActiveTimers : public Executable
 {
 public:
@@ -67,6 +74,17 @@ public:
 
     /** @return true if there are no timers waiting. */
     bool empty();
+
+    /** Switches this instance to keep the timers in a hierarchical timing
+     * wheel instead of a sorted list. Must be called before any timer is
+     * scheduled, typically right after the executor is created.
+     *
+     * Timers never expire before their schedule_time(). Timers that expire
+     * within the same tick are not ordered among each other.
+     *
+     * @param tick_shift log2 of the wheel's resolution in nanoseconds. The
+     * default gives about 1 msec. */
+    void use_timing_wheel(unsigned tick_shift = 20);
     
     /** Adds a new timer to the active timer list. It is OK to schedule a timer
      * that is already expired, which will then wake up the executor.
@@ -76,16 +94,17 @@ public:
     void schedule_timer(::Timer *timer);
 
     /** Updates the expiration time of an already scheduled timer. This call is
-     * somewhat expensive, because it needs to walk the entire queue of active
-     * timers. May wake up the executor.
+     * somewhat expensive in list mode, because it needs to walk the entire
+     * queue of active timers. May wake up the executor.
      *
      * @param timer is the timer whose next execution time has been updated. It
      * must already be scheduled. */
     void update_timer(::Timer *timer);
 
     /** Deletes an already scheduled but not yet expired timer. This call is
-     * somewhat expensive, because it needs to walk the entire queue of active
-     * timers. Asserts that the timer is in fact not yet expired.
+     * somewhat expensive in list mode, because it needs to walk the entire
+     * queue of active timers. Asserts that the timer is in fact not yet
+     * expired.
      *
      * @param timer is the timer to delete. */
     void remove_timer(::Timer *timer);
@@ -113,12 +132,65 @@ private:
      * @param timer what to insert into the active list. */
     void insert_locked(::Timer *timer);
 
+    /// Number of slots on the fine level of the timing wheel. Each slot
+    /// holds the timers of one tick.
+    static constexpr unsigned WHEEL_SLOTS = 256;
+    /// Number of slots on the coarse level of the timing wheel. Each slot
+    /// holds the timers of WHEEL_SLOTS ticks.
+    static constexpr unsigned WHEEL_COARSE_SLOTS = 64;
+
+    /// Storage of the timing wheel.
+    struct Wheel
+    {
+        /// Heads of the fine level slots.
+        QMember *fine[WHEEL_SLOTS];
+        /// Heads of the coarse level slots.
+        QMember *coarse[WHEEL_COARSE_SLOTS];
+        /// Timers too far in the future for the coarse level. Unsorted.
+        QMember *overflow;
+        /// One bit for each fine slot that may be non-empty.
+        uint32_t fineBits[WHEEL_SLOTS / 32];
+        /// The tick the fine level is at. All timers before this tick have
+        /// expired.
+        long long tick;
+        /// Number of timers scheduled.
+        unsigned count;
+    };
+
+    /** Adds a timer to the appropriate slot of the timing wheel. Caller must
+     * hold the lock. @param timer what to add. */
+    void wheel_link_locked(::Timer *timer);
+
+    /** Removes a timer from its slot of the timing wheel. Caller must hold
+     * the lock. @param timer what to remove. */
+    void wheel_unlink_locked(::Timer *timer);
+
+    /** Moves the timers of the overflow list and of the current coarse slot
+     * to the levels below. Called when the wheel's tick reaches a coarse
+     * slot boundary. Caller must hold the lock. */
+    void wheel_cascade_locked();
+
+    /** Finds the first fine slot at or after a given slot that may be
+     * non-empty, without wrapping around. Caller must hold the lock.
+     * @param slot where to start looking.
+     * @return the slot index, or WHEEL_SLOTS if there is none. */
+    unsigned wheel_next_slot_locked(unsigned slot);
+
+    /** Implementation of get_next_timeout() for the timing wheel. Caller must
+     * hold the lock. @param now current time. @return nanoseconds to sleep. */
+    long long wheel_next_timeout_locked(long long now);
+
     /// Parent.
     ExecutorBase *executor_;
     /// Protects the timer list.
     OSMutex lock_;
     /// List of timers that are scheduled.
     QMember activeTimers_;
+    /// Timing wheel of the scheduled timers, or null if the sorted list is
+    /// used.
+    std::unique_ptr<Wheel> wheel_;
+    /// log2 of the timing wheel's resolution in nanoseconds.
+    uint8_t tickShift_ {0};
     /// 1 if we in the executor's queue.
     std::atomic_uint_least8_t isPending_;
 
@@ -140,6 +212,7 @@ public:
         : activeTimers_(timers)
         , priority_(UINT_MAX)
         , when_(0)
+        , wheelLink_(nullptr)
         , period_(0)
         , isActive_(0)
         , isExpired_(0)
@@ -300,6 +373,9 @@ private:
     unsigned priority_;
     /** when in nanoseconds timer should expire */
     long long when_;
+    /** In timing wheel mode, points to the link that points to this timer,
+     * so that the timer can be removed without searching. */
+    QMember **wheelLink_;
     /** period in nanoseconds for timer */
     long long period_;
     /** true when the timer is in the active timers list */
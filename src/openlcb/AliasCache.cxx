@@ -64,14 +64,46 @@ static NodeAlias resolve_notresponding(NodeAlias stored)
 extern volatile int consistency_result;
 volatile int consistency_result = 0;
 
+/// Set to false in tests to skip the (expensive) consistency check after
+/// every modification, e.g. in benchmarks.
+extern bool alias_cache_check_consistency;
+bool alias_cache_check_consistency = true;
+
 int AliasCache::check_consistency()
 {
-    if (idMap.size() != aliasMap.size())
+    size_t used;
+    if (aliasHash)
+    {
+        unsigned alias_used = 0;
+        unsigned id_used = 0;
+        for (unsigned i = 0; i < (1u << hashBits); ++i)
+        {
+            if (aliasHash[i] != NONE_ENTRY)
+            {
+                ++alias_used;
+            }
+            if (idHash[i] != NONE_ENTRY)
+            {
+                ++id_used;
+            }
+        }
+        if (alias_used != id_used)
+        {
+            LOG(INFO, "id hash size != alias hash size.");
+            return 1;
+        }
+        used = alias_used;
+    }
+    else
     {
-        LOG(INFO, "idmap size != aliasmap size.");
-        return 1;
+        if (idMap.size() != aliasMap.size())
+        {
+            LOG(INFO, "idmap size != aliasmap size.");
+            return 1;
+        }
+        used = aliasMap.size();
     }
-    if (aliasMap.size() == entries)
+    if (used == entries)
     {
         if (!freeList.empty())
         {
@@ -87,7 +119,7 @@ int AliasCache::check_consistency()
             return 3;
         }
     }
-    if (aliasMap.size() == 0 && (!oldest.empty() || !newest.empty()))
+    if (used == 0 && (!oldest.empty() || !newest.empty()))
     {
         LOG(INFO, "LRU head/tail elements should be null when map is empty.");
         return 4;
@@ -103,11 +135,24 @@ int AliasCache::check_consistency()
         }
         free_entries.insert(m);
     }
-    if (free_entries.size() + aliasMap.size() != entries)
+    if (free_entries.size() + used != entries)
     {
         LOG(INFO, "Lost some metadata entries.");
         return 6;
     }
+    for (unsigned i = 0; aliasHash && i < (1u << hashBits); ++i)
+    {
+        if (aliasHash[i] != NONE_ENTRY && free_entries.count(pool + aliasHash[i]))
+        {
+            LOG(INFO, "Found an aliasmap entry in the freelist.");
+            return 19;
+        }
+        if (idHash[i] != NONE_ENTRY && free_entries.count(pool + idHash[i]))
+        {
+            LOG(INFO, "Found an id entry in the freelist.");
+            return 20;
+        }
+    }
     for (auto kv : aliasMap)
     {
         if (free_entries.count(kv.deref(this)))
@@ -124,7 +169,7 @@ int AliasCache::check_consistency()
             return 20;
         }
     }
-    if (aliasMap.size() == 0)
+    if (used == 0)
     {
         if (!oldest.empty())
         {
@@ -160,7 +205,7 @@ int AliasCache::check_consistency()
             return 12; // newest is free
         }
     }
-    if (aliasMap.size() == 0)
+    if (used == 0)
     {
         return 0;
     }
@@ -194,7 +239,7 @@ int AliasCache::check_consistency()
             LOG(INFO, "Prev link points to newest.");
             return 18;
         }
-        if (count != aliasMap.size())
+        if (count != used)
         {
             LOG(INFO, "LRU link list length is incorrect.");
             return 27;
@@ -235,23 +280,23 @@ int AliasCache::check_consistency()
             continue;
         }
         auto *e = pool + i;
-        if (idMap.find(e->get_node_id()) == idMap.end())
+        if (find_id(e->get_node_id()).empty())
         {
             LOG(INFO, "Metadata ID is not in the id map.");
             return 23;
         }
-        if (idMap.find(e->get_node_id())->idx_ != i)
+        if (find_id(e->get_node_id()).idx_ != i)
         {
             LOG(INFO,
                 "Id map entry does not point back to the expected index.");
             return 24;
         }
-        if (aliasMap.find(e->alias_) == aliasMap.end())
+        if (find_alias(e->alias_).empty())
         {
             LOG(INFO, "Metadata alias is not in the alias map.");
             return 25;
         }
-        if (aliasMap.find(e->alias_)->idx_ != i)
+        if (find_alias(e->alias_).idx_ != i)
         {
             LOG(INFO,
                 "Alis map entry does not point back to the expected index.");
@@ -267,6 +312,14 @@ void AliasCache::clear()
 {
     idMap.clear();
     aliasMap.clear();
+    if (aliasHash)
+    {
+        for (unsigned i = 0; i < (1u << hashBits); ++i)
+        {
+            aliasHash[i] = NONE_ENTRY;
+            idHash[i] = NONE_ENTRY;
+        }
+    }
     oldest.idx_ = NONE_ENTRY;
     newest.idx_ = NONE_ENTRY;
     freeList.idx_ = NONE_ENTRY;
@@ -279,6 +332,122 @@ void AliasCache::clear()
     }
 }
 
+unsigned AliasCache::alias_slot(NodeAlias alias)
+{
+    unsigned mask = (1u << hashBits) - 1;
+    unsigned i = hash_home(alias);
+    while (aliasHash[i] != NONE_ENTRY && pool[aliasHash[i]].alias_ != alias)
+    {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+unsigned AliasCache::id_slot(NodeID id)
+{
+    unsigned mask = (1u << hashBits) - 1;
+    unsigned i = hash_home(id_key(id));
+    while (idHash[i] != NONE_ENTRY && pool[idHash[i]].get_node_id() != id)
+    {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+void AliasCache::hash_erase(uint16_t *table, unsigned slot, bool by_alias)
+{
+    unsigned mask = (1u << hashBits) - 1;
+    unsigned j = slot;
+    while (true)
+    {
+        j = (j + 1) & mask;
+        if (table[j] == NONE_ENTRY)
+        {
+            break;
+        }
+        Metadata *m = pool + table[j];
+        unsigned home = hash_home(
+            by_alias ? (uint32_t)m->alias_ : id_key(m->get_node_id()));
+        // The entry at j can fill the hole at slot only if its home position
+        // is not cyclically within (slot, j].
+        if (((j - home) & mask) >= ((j - slot) & mask))
+        {
+            table[slot] = table[j];
+            slot = j;
+        }
+    }
+    table[slot] = NONE_ENTRY;
+}
+
+AliasCache::PoolIdx AliasCache::find_alias(NodeAlias alias)
+{
+    PoolIdx ret;
+    if (aliasHash)
+    {
+        ret.idx_ = aliasHash[alias_slot(alias)];
+    }
+    else
+    {
+        auto it = aliasMap.find(alias);
+        if (it != aliasMap.end())
+        {
+            ret = *it;
+        }
+    }
+    return ret;
+}
+
+AliasCache::PoolIdx AliasCache::find_id(NodeID id)
+{
+    PoolIdx ret;
+    if (idHash)
+    {
+        ret.idx_ = idHash[id_slot(id)];
+    }
+    else
+    {
+        auto it = idMap.find(id);
+        if (it != idMap.end())
+        {
+            ret = *it;
+        }
+    }
+    return ret;
+}
+
+void AliasCache::index_insert(PoolIdx n)
+{
+    if (aliasHash)
+    {
+        Metadata *m = n.deref(this);
+        unsigned as = alias_slot(m->alias_);
+        HASSERT(aliasHash[as] == NONE_ENTRY);
+        aliasHash[as] = n.idx_;
+        unsigned is = id_slot(m->get_node_id());
+        HASSERT(idHash[is] == NONE_ENTRY);
+        idHash[is] = n.idx_;
+    }
+    else
+    {
+        aliasMap.insert(PoolIdx(n));
+        idMap.insert(PoolIdx(n));
+    }
+}
+
+void AliasCache::index_erase(Metadata *metadata)
+{
+    if (aliasHash)
+    {
+        hash_erase(aliasHash, alias_slot(metadata->alias_), true);
+        hash_erase(idHash, id_slot(metadata->get_node_id()), false);
+    }
+    else
+    {
+        aliasMap.erase(aliasMap.find(metadata->alias_));
+        idMap.erase(idMap.find(metadata->get_node_id()));
+    }
+}
+
 void debug_print_entry(void *, NodeID id, NodeAlias alias)
 {
     LOG(INFO, "[%012" PRIx64 "]: %03X", id, alias);
@@ -301,16 +470,16 @@ void AliasCache::add(NodeID id, NodeAlias alias)
     
     Metadata *insert;
 
-    auto it = aliasMap.find(alias);
-    if (alias == NOT_RESPONDING)
+    PoolIdx it;
+    if (alias != NOT_RESPONDING)
     {
         // We can have more than one NOT_RESPONDING entry.
-        it = aliasMap.end();
+        it = find_alias(alias);
     }
-    if (it != aliasMap.end())
+    if (!it.empty())
     {
         /* we already have a mapping for this alias, so lets remove it */
-        insert = it->deref(this);
+        insert = it.deref(this);
         auto nid = insert->get_node_id();
         remove(insert->alias_);
 
@@ -320,11 +489,11 @@ void AliasCache::add(NodeID id, NodeAlias alias)
             (*removeCallback)(nid, insert->alias_, context);
         }
     }
-    auto nit = idMap.find(id);
-    if (nit != idMap.end())
+    PoolIdx nit = find_id(id);
+    if (!nit.empty())
     {
         /* we already have a mapping for this id, so lets remove it */
-        insert = nit->deref(this);
+        insert = nit.deref(this);
         auto nid = insert->get_node_id();
         remove(insert->alias_);
 
@@ -358,8 +527,7 @@ void AliasCache::add(NodeID id, NodeAlias alias)
         }
         oldest = second;
 
-        aliasMap.erase(aliasMap.find(insert->alias_));
-        idMap.erase(idMap.find(insert->get_node_id()));
+        index_erase(insert);
 
         if (removeCallback)
         {
@@ -373,16 +541,14 @@ void AliasCache::add(NodeID id, NodeAlias alias)
         // This code will make all NOT_RESPONDING aliases unique in our map.
         unsigned ofs = insert - pool;
         alias = NOT_RESPONDING | ofs;
-        auto it = aliasMap.find(alias);
-        HASSERT(it == aliasMap.end());
+        HASSERT(find_alias(alias).empty());
     }
     insert->set_node_id(id);
     insert->alias_ = alias;
 
     PoolIdx n;
     n.idx_ = insert - pool;
-    aliasMap.insert(PoolIdx(n));
-    idMap.insert(PoolIdx(n));
+    index_insert(n);
 
     /* update the time based list */
     insert->newer_.idx_ = NONE_ENTRY;
@@ -403,8 +569,11 @@ void AliasCache::add(NodeID id, NodeAlias alias)
     newest = n;
 
 #if defined(TEST_CONSISTENCY)
-    consistency_result = check_consistency();
-    HASSERT(0 == consistency_result);
+    if (alias_cache_check_consistency)
+    {
+        consistency_result = check_consistency();
+        HASSERT(0 == consistency_result);
+    }
 #endif
 }
 
@@ -415,13 +584,12 @@ void AliasCache::add(NodeID id, NodeAlias alias)
  */
 void AliasCache::remove(NodeAlias alias)
 {
-    auto it = aliasMap.find(alias);
+    PoolIdx it = find_alias(alias);
 
-    if (it != aliasMap.end())
+    if (!it.empty())
     {
-        Metadata *metadata = it->deref(this);
-        aliasMap.erase(it);
-        idMap.erase(idMap.find(metadata->get_node_id()));
+        Metadata *metadata = it.deref(this);
+        index_erase(metadata);
         // Ensures that the AME query handler does not find this metadata.
         metadata->set_node_id(0);
 
@@ -449,8 +617,11 @@ void AliasCache::remove(NodeAlias alias)
     }
 
 #if defined(TEST_CONSISTENCY)
-    consistency_result = check_consistency();
-    HASSERT(0 == consistency_result);
+    if (alias_cache_check_consistency)
+    {
+        consistency_result = check_consistency();
+        HASSERT(0 == consistency_result);
+    }
 #endif
 }
 
@@ -475,12 +646,33 @@ bool AliasCache::retrieve(unsigned entry, NodeID* node, NodeAlias* alias)
 
 bool AliasCache::next_entry(NodeID bound, NodeID *node, NodeAlias *alias)
 {
-    auto it = idMap.upper_bound(bound);
-    if (it == idMap.end())
+    Metadata *metadata = nullptr;
+    if (idHash)
+    {
+        // The hash tables are not ordered; finds the smallest ID above the
+        // bound by walking all entries.
+        for (PoolIdx idx = newest; !idx.empty(); idx = idx.deref(this)->older_)
+        {
+            Metadata *m = idx.deref(this);
+            NodeID id = m->get_node_id();
+            if (id > bound && (!metadata || id < metadata->get_node_id()))
+            {
+                metadata = m;
+            }
+        }
+    }
+    else
+    {
+        auto it = idMap.upper_bound(bound);
+        if (it != idMap.end())
+        {
+            metadata = it->deref(this);
+        }
+    }
+    if (!metadata)
     {
         return false;
     }
-    Metadata *metadata = it->deref(this);
     if (alias)
     {
         *alias = resolve_notresponding(metadata->alias_);
@@ -500,11 +692,11 @@ NodeAlias AliasCache::lookup(NodeID id)
 {
     HASSERT(id != 0);
 
-    auto it = idMap.find(id);
+    PoolIdx it = find_id(id);
 
-    if (it != idMap.end())
+    if (!it.empty())
     {
-        Metadata *metadata = it->deref(this);
+        Metadata *metadata = it.deref(this);
 
         /* update timestamp */
         touch(metadata);
@@ -526,11 +718,11 @@ NodeID AliasCache::lookup(NodeAlias alias)
         return 0;
     }
 
-    auto it = aliasMap.find(alias);
+    PoolIdx it = find_alias(alias);
 
-    if (it != aliasMap.end())
+    if (!it.empty())
     {
-        Metadata *metadata = it->deref(this);
+        Metadata *metadata = it.deref(this);
 
         /* update timestamp */
         touch(metadata);
@@ -602,8 +794,11 @@ void AliasCache::touch(Metadata* metadata)
         newest.idx_ = metadata - pool;
     }
 #if defined(TEST_CONSISTENCY)
-    consistency_result = check_consistency();
-    HASSERT(0 == consistency_result);
+    if (alias_cache_check_consistency)
+    {
+        consistency_result = check_consistency();
+        HASSERT(0 == consistency_result);
+    }
 #endif
 }
 
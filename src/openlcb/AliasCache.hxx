@@ -82,20 +82,41 @@ namespace openlcb
  *
  * A similar sorted vector is kept sorted by the NodeID values. This also takes
  * only 2 bytes per entry.
+ *
+ * Inserting into and removing from the sorted vectors is linear in the number
+ * of entries. For caches with thousands of entries (e.g. the remote aliases on
+ * a gateway) the INDEX_HASH option replaces the sorted vectors with two
+ * open-addressed hash tables of PoolIdx, one keyed by alias and one keyed by
+ * NodeID. These are sized at construction to a power of two at least twice
+ * the number of entries (4-8 bytes per entry per table), and use linear
+ * probing with backward-shift deletion, so lookup, insert and remove are
+ * constant time and no memory is allocated after construction. In this mode
+ * next_entry() is linear in the number of entries.
  */
 class AliasCache
 {
 public:
+    /// Selects the data structure used for looking up entries.
+    enum IndexType
+    {
+        /// Sorted vectors. Smallest memory footprint, O(log n) lookup, O(n)
+        /// insert and remove.
+        INDEX_SORTED,
+        /// Open-addressed hash tables. O(1) lookup, insert and remove.
+        INDEX_HASH,
+    };
+
     /** Constructor.
      * @param seed starting seed for generation of aliases
      * @param entries maximum number of entries in this cache
      * @param remove_callback callback to call when we remove a mapping from
      *        the cache however it will not be called in the remove() method
      * @param context context pointer to pass to remove_callback
+     * @param index selects the lookup data structure
      */
     AliasCache(NodeID seed, size_t _entries,
         void (*remove_callback)(NodeID id, NodeAlias alias, void *) = NULL,
-        void *context = NULL)
+        void *context = NULL, IndexType index = INDEX_SORTED)
         : pool(new Metadata[_entries])
         , aliasMap(this)
         , idMap(this)
@@ -104,8 +125,22 @@ public:
         , removeCallback(remove_callback)
         , context(context)
     {
-        aliasMap.reserve(_entries);
-        idMap.reserve(_entries);
+        HASSERT(_entries < NONE_ENTRY);
+        if (index == INDEX_HASH)
+        {
+            hashBits = 4;
+            while ((1u << hashBits) < 2 * _entries)
+            {
+                ++hashBits;
+            }
+            aliasHash = new uint16_t[1u << hashBits];
+            idHash = new uint16_t[1u << hashBits];
+        }
+        else
+        {
+            aliasMap.reserve(_entries);
+            idMap.reserve(_entries);
+        }
         clear();
     }
 
@@ -181,6 +216,8 @@ public:
     ~AliasCache()
     {
         delete [] pool;
+        delete [] aliasHash;
+        delete [] idHash;
     }
 
     /** Visible for testing. Check internal consistency. */
@@ -345,6 +382,17 @@ private:
     /** Map of Node ID to corresponding Metadata */
     IdMap idMap;
 
+    /** Hash table of pool indexes keyed by alias, or nullptr when using the
+     * sorted aliasMap. */
+    uint16_t *aliasHash = nullptr;
+
+    /** Hash table of pool indexes keyed by Node ID, or nullptr when using the
+     * sorted idMap. */
+    uint16_t *idHash = nullptr;
+
+    /** log2 of the number of slots in aliasHash and idHash. */
+    unsigned hashBits = 0;
+
     /** list of unused mapping entries (index into pool) */
     PoolIdx freeList;
 
@@ -371,6 +419,59 @@ private:
      */
     void touch(Metadata* metadata);
 
+    /** Finds an entry by alias.
+     * @param alias alias to look for
+     * @return the entry's index or an empty PoolIdx if not found */
+    PoolIdx find_alias(NodeAlias alias);
+
+    /** Finds an entry by Node ID.
+     * @param id Node ID to look for
+     * @return the entry's index or an empty PoolIdx if not found */
+    PoolIdx find_id(NodeID id);
+
+    /** Adds an entry to the alias and ID indexes.
+     * @param n pool index of the entry; its alias and Node ID must be set. */
+    void index_insert(PoolIdx n);
+
+    /** Removes an entry from the alias and ID indexes.
+     * @param metadata the entry; its alias and Node ID must be unchanged
+     * since index_insert. */
+    void index_erase(Metadata *metadata);
+
+    /** @return the hash table slot where a given key should start being
+     * searched.
+     * @param key folded 32-bit key value */
+    unsigned hash_home(uint32_t key)
+    {
+        // Fibonacci hashing: the top bits of the product are well mixed.
+        return (key * 0x9E3779B1u) >> (32 - hashBits);
+    }
+
+    /** @return the folded hash key of a Node ID.
+     * @param id Node ID */
+    static uint32_t id_key(NodeID id)
+    {
+        return (uint32_t)id ^ ((uint32_t)(id >> 32) * 0x85EBCA6Bu);
+    }
+
+    /** @return the slot in aliasHash that contains the given alias, or the
+     * empty slot where it would be inserted.
+     * @param alias alias to look for */
+    unsigned alias_slot(NodeAlias alias);
+
+    /** @return the slot in idHash that contains the given Node ID, or the
+     * empty slot where it would be inserted.
+     * @param id Node ID to look for */
+    unsigned id_slot(NodeID id);
+
+    /** Removes an occupied slot from a hash table, shifting back the
+     * following entries of the probe sequence so that no tombstones are
+     * needed.
+     * @param table aliasHash or idHash
+     * @param slot the slot to clear
+     * @param by_alias true if table is aliasHash */
+    void hash_erase(uint16_t *table, unsigned slot, bool by_alias);
+
     DISALLOW_COPY_AND_ASSIGN(AliasCache);
 };
 
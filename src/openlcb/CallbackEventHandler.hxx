@@ -237,9 +237,7 @@ protected:
         EventState state =
             stateHandler_ ? stateHandler_(entry, event) : EventState::UNKNOWN;
         Defs::MTI mti = Defs::MTI_PRODUCER_IDENTIFIED_VALID + state;
-        event->event_write_helper<1>()->WriteAsync(node_, mti,
-            WriteHelper::global(), eventid_to_buffer(entry.event),
-            done->new_child());
+        event->send_identified<1>(node_, mti, entry.event, done->new_child());
     }
 
     /// Helper function for implementations.
@@ -249,9 +247,7 @@ protected:
         EventState state =
             stateHandler_ ? stateHandler_(entry, event) : EventState::UNKNOWN;
         Defs::MTI mti = Defs::MTI_CONSUMER_IDENTIFIED_VALID + state;
-        event->event_write_helper<3>()->WriteAsync(node_, mti,
-            WriteHelper::global(), eventid_to_buffer(entry.event),
-            done->new_child());
+        event->send_identified<3>(node_, mti, entry.event, done->new_child());
     }
 
 private:
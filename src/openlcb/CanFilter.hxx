@@ -38,6 +38,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <vector>
 
 #include "openlcb/CanDefs.hxx"
@@ -62,10 +63,42 @@ namespace openlcb
  * The remove_port method IS thread-safe and can be called from any thread.
  * It schedules the removal which is applied at the beginning of the next
  * prepare_packet call.
+ *
+ * There are two implementations of the routing table. TABLE_MULTIMAP
+ * allocates a multimap node per learned (alias, port) pair. TABLE_FLAT is a
+ * 4096-entry array directly indexed by the alias, where each entry is a
+ * bitmask of port slots. Every port that sends a frame gets a slot (up to
+ * MAX_PORT_SLOTS); aliases behind further ports are flooded. When a port is
+ * removed, its slot is marked dead, which takes effect immediately. The bits
+ * of dead slots are cleared from the table incrementally, a few entries per
+ * frame, after which the slot is reused.
  */
 class CanFilter
 {
 public:
+    /// Selects the routing table implementation.
+    enum TableType
+    {
+        /// std::multimap keyed by alias. Memory use is proportional to the
+        /// number of learned aliases.
+        TABLE_MULTIMAP,
+        /// Flat array of port bitmasks indexed by alias. Uses 16 kbytes.
+        TABLE_FLAT,
+    };
+
+    /// How many ports can be tracked precisely with TABLE_FLAT.
+    static constexpr unsigned MAX_PORT_SLOTS = 31;
+
+    /// Constructor.
+    /// @param type which routing table implementation to use.
+    CanFilter(TableType type = TABLE_MULTIMAP)
+    {
+        if (type == TABLE_FLAT)
+        {
+            flatTable_.reset(new uint32_t[NUM_ALIASES]());
+        }
+    }
+
     /**
      * Prepares the packet for routing.
      *
@@ -82,6 +115,11 @@ public:
         {
             apply_pending_removals();
         }
+        if (flatTable_)
+        {
+            prepare_flat(frame);
+            return;
+        }
 
         const struct can_frame &can_frame = frame->frame();
 
@@ -190,6 +228,114 @@ public:
     }
 
 private:
+    /// Number of entries in the flat table.
+    static constexpr unsigned NUM_ALIASES = 4096;
+    /// Bit in the flat table entries that marks an alias seen on a port that
+    /// did not get a slot.
+    static constexpr uint32_t FLOOD_BIT = 1u << MAX_PORT_SLOTS;
+    /// How many flat table entries to clean of dead slot bits per frame.
+    static constexpr unsigned SWEEP_STEP = 16;
+
+    /**
+     * Implementation of prepare_packet for TABLE_FLAT.
+     * @param frame The CAN hub data containing the frame and source port info.
+     */
+    void prepare_flat(CanHubData *frame)
+    {
+        if (deadSlots_)
+        {
+            sweep_dead_slots();
+        }
+
+        const struct can_frame &can_frame = frame->frame();
+        uintptr_t src_port = reinterpret_cast<uintptr_t>(frame->skipMember_);
+        uint32_t &src_entry = flatTable_[get_source_address(can_frame)];
+        uint32_t src_bit = port_bit(src_port);
+        if ((src_entry & src_bit) == 0)
+        {
+            src_entry |= src_bit;
+        }
+
+        sourcePort_ = src_port;
+        targetPorts_.clear();
+        isBroadcast_ = true;
+        if (is_broadcast(can_frame))
+        {
+            return;
+        }
+        NodeAlias dst = get_destination_address(can_frame);
+        if (dst == 0)
+        {
+            return;
+        }
+        uint32_t targets = flatTable_[dst] & ~deadSlots_;
+        if (targets == 0 || (targets & FLOOD_BIT))
+        {
+            // Unknown destination or one behind a port without a slot.
+            return;
+        }
+        isBroadcast_ = false;
+        while (targets)
+        {
+            targetPorts_.push_back(slotPorts_[__builtin_ctz(targets)]);
+            targets &= targets - 1;
+        }
+    }
+
+    /**
+     * Finds or allocates the slot of a port in the flat table.
+     * @param port_id The identifier of the port.
+     * @return the bit of the port's slot, or FLOOD_BIT if all slots are
+     * taken.
+     */
+    uint32_t port_bit(uintptr_t port_id)
+    {
+        uint32_t live = usedSlots_ & ~deadSlots_;
+        for (uint32_t m = live; m; m &= m - 1)
+        {
+            unsigned slot = __builtin_ctz(m);
+            if (slotPorts_[slot] == port_id)
+            {
+                return 1u << slot;
+            }
+        }
+        uint32_t free_slots = ~usedSlots_ & (FLOOD_BIT - 1);
+        if (!free_slots)
+        {
+            return FLOOD_BIT;
+        }
+        unsigned slot = __builtin_ctz(free_slots);
+        slotPorts_[slot] = port_id;
+        usedSlots_ |= 1u << slot;
+        return 1u << slot;
+    }
+
+    /**
+     * Clears the bits of dead slots from the next few flat table entries.
+     * When a full pass is done, the slots that were dead at the start of the
+     * pass are freed.
+     */
+    void sweep_dead_slots()
+    {
+        if (sweepPos_ == 0)
+        {
+            sweepingSlots_ = deadSlots_;
+        }
+        uint32_t keep = ~sweepingSlots_;
+        for (unsigned i = 0; i < SWEEP_STEP; ++i)
+        {
+            flatTable_[sweepPos_ + i] &= keep;
+        }
+        sweepPos_ += SWEEP_STEP;
+        if (sweepPos_ >= NUM_ALIASES)
+        {
+            sweepPos_ = 0;
+            deadSlots_ &= ~sweepingSlots_;
+            usedSlots_ &= ~sweepingSlots_;
+            sweepingSlots_ = 0;
+        }
+    }
+
     /**
      * Applies pending port removals to the routing table.
      */
@@ -204,6 +350,19 @@ private:
 
         for (uintptr_t port_id : removals)
         {
+            if (flatTable_)
+            {
+                uint32_t live = usedSlots_ & ~deadSlots_;
+                for (uint32_t m = live; m; m &= m - 1)
+                {
+                    unsigned slot = __builtin_ctz(m);
+                    if (slotPorts_[slot] == port_id)
+                    {
+                        deadSlots_ |= 1u << slot;
+                    }
+                }
+                continue;
+            }
             for (auto it = routingTable_.begin(); it != routingTable_.end();)
             {
                 if (it->second == port_id)
@@ -292,9 +451,29 @@ private:
         return false;
     }
 
-    /// Stores mapping from Alias to Port ID.
+    /// Stores mapping from Alias to Port ID (TABLE_MULTIMAP).
     std::multimap<NodeAlias, uintptr_t> routingTable_;
 
+    /// Indexed by alias, the bitmask of port slots where the alias was seen
+    /// (TABLE_FLAT). nullptr when using the multimap.
+    std::unique_ptr<uint32_t[]> flatTable_;
+
+    /// Port identifier for each slot of the flat table.
+    uintptr_t slotPorts_[MAX_PORT_SLOTS];
+
+    /// Bitmask of slots that are assigned to a port (including dead ones).
+    uint32_t usedSlots_ {0};
+
+    /// Bitmask of slots whose port was removed, but may still appear in the
+    /// flat table.
+    uint32_t deadSlots_ {0};
+
+    /// Dead slots that the current sweep pass is clearing from the table.
+    uint32_t sweepingSlots_ {0};
+
+    /// Next flat table entry to sweep.
+    unsigned sweepPos_ {0};
+
     /// True if the current packet should be broadcast (sent to all except
     /// source).
     bool isBroadcast_ {false};
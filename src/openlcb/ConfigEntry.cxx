@@ -34,16 +34,101 @@
 
 #include "openlcb/ConfigEntry.hxx"
 
+#include <atomic>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include "os/os.h"
 #include "utils/logging.h"
 #include "utils/FdUtils.hxx"
 
 namespace openlcb
 {
 
+/// The snapshot currently serving reads, or nullptr. Set by the thread that
+/// activates it, but read from any thread that accesses a config file.
+static std::atomic<ConfigSnapshot *> activeSnapshot {nullptr};
+/// The thread that activated activeSnapshot. Stored before activeSnapshot,
+/// so a reader that sees the snapshot also sees the matching thread.
+static std::atomic<os_thread_t> activeSnapshotThread;
+
+bool ConfigSnapshot::load(int fd, size_t max_size)
+{
+    clear();
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+        (size_t)st.st_size > max_size)
+    {
+        return false;
+    }
+    size_ = st.st_size;
+    image_.reset(new uint8_t[size_]);
+    int ret = lseek(fd, 0, SEEK_SET);
+    ERRNOCHECK("seek_config", ret);
+    FdUtils::repeated_read(fd, image_.get(), size_);
+    fd_ = fd;
+    return true;
+}
+
+ConfigSnapshot::Activate::Activate(ConfigSnapshot *snapshot)
+    : active_(snapshot->valid())
+{
+    if (active_)
+    {
+        HASSERT(!activeSnapshot.load());
+        activeSnapshotThread.store(os_thread_self(), std::memory_order_relaxed);
+        activeSnapshot.store(snapshot, std::memory_order_release);
+    }
+}
+
+ConfigSnapshot::Activate::~Activate()
+{
+    if (active_)
+    {
+        activeSnapshot = nullptr;
+    }
+}
+
+bool ConfigSnapshot::read(int fd, unsigned offset, void *buf, size_t size)
+{
+    ConfigSnapshot *s = activeSnapshot.load(std::memory_order_acquire);
+    // Other threads must not touch the snapshot, because its owner may
+    // destroy it at any time.
+    if (!s || activeSnapshotThread.load(std::memory_order_relaxed) !=
+            os_thread_self() ||
+        s->fd_ != fd || offset + size > s->size_)
+    {
+        return false;
+    }
+    memcpy(buf, s->image_.get() + offset, size);
+    return true;
+}
+
+void ConfigSnapshot::write(
+    int fd, unsigned offset, const void *buf, size_t size)
+{
+    ConfigSnapshot *s = activeSnapshot.load(std::memory_order_acquire);
+    if (!s || activeSnapshotThread.load(std::memory_order_relaxed) !=
+            os_thread_self() ||
+        s->fd_ != fd)
+    {
+        return;
+    }
+    if (offset + size > s->size_)
+    {
+        // The file grew; the image does not cover it anymore.
+        s->clear();
+        return;
+    }
+    memcpy(s->image_.get() + offset, buf, size);
+}
+
 void ConfigEntryBase::repeated_read(int fd, void *buf, size_t size) const
 {
+    if (ConfigSnapshot::read(fd, offset_, buf, size))
+    {
+        return;
+    }
     int ret = lseek(fd, offset_, SEEK_SET);
     ERRNOCHECK("seek_config", ret);
     FdUtils::repeated_read(fd, buf, size);
@@ -54,6 +139,7 @@ void ConfigEntryBase::repeated_write(int fd, const void *buf, size_t size) const
     int ret = lseek(fd, offset_, SEEK_SET);
     ERRNOCHECK("seek_config", ret);
     FdUtils::repeated_write(fd, buf, size);
+    ConfigSnapshot::write(fd, offset_, buf, size);
 }
 
 } // namespace openlcb
@@ -41,6 +41,7 @@
 #include <sys/types.h>
 
 #include <functional>
+#include <memory>
 
 #include "openlcb/ConfigRenderer.hxx"
 
@@ -84,6 +85,88 @@ protected:
 /// in the configuration space.
 typedef std::function<void(unsigned)> EventOffsetCallback;
 
+/// In-memory image of the configuration file. While a snapshot is active
+/// (see ConfigSnapshot::Activate), the reads of the configuration entries
+/// from the same file descriptor on the activating thread are served from
+/// memory instead of issuing a seek and a read syscall for every field. Writes
+/// still go to the file and are copied into the image as well.
+///
+/// The image is not updated by writes that bypass the configuration entries
+/// (e.g. the memory config protocol writing to the file), so the owner has to
+/// reload it when the file may have changed.
+class ConfigSnapshot
+{
+public:
+    /// Reads the entire configuration file into memory. Does nothing if the
+    /// file is not a regular file or larger than max_size.
+    ///
+    /// @param fd configuration file to read.
+    /// @param max_size the largest file that will be cached.
+    ///
+    /// @return true if the image is valid.
+    ///
+    bool load(int fd, size_t max_size);
+
+    /// Releases the memory used by the image.
+    void clear()
+    {
+        fd_ = -1;
+        size_ = 0;
+        image_.reset();
+    }
+
+    /// @return true if the image holds the contents of a file.
+    bool valid() const
+    {
+        return fd_ >= 0;
+    }
+
+    /// RAII class making a snapshot the active one for the calling thread
+    /// until it goes out of scope. Does nothing if the snapshot is not valid.
+    /// There can be at most one active snapshot at a time.
+    class Activate
+    {
+    public:
+        /// @param snapshot is the image to serve reads from.
+        Activate(ConfigSnapshot *snapshot);
+        ~Activate();
+
+    private:
+        /// true if the constructor installed the snapshot.
+        bool active_;
+    };
+
+    /// Serves a read from the active snapshot.
+    ///
+    /// @param fd file the read was issued to
+    /// @param offset offset in the file
+    /// @param buf where to copy data
+    /// @param size how many bytes to copy
+    ///
+    /// @return false if there is no active snapshot for fd covering the
+    /// requested range; the caller needs to read from the file then.
+    ///
+    static bool read(int fd, unsigned offset, void *buf, size_t size);
+
+    /// Updates the active snapshot after a write to the file. Does nothing if
+    /// there is no active snapshot for fd.
+    ///
+    /// @param fd file the data was written to
+    /// @param offset offset in the file
+    /// @param buf data written
+    /// @param size how many bytes were written
+    ///
+    static void write(int fd, unsigned offset, const void *buf, size_t size);
+
+private:
+    /// File descriptor the image was loaded from, -1 if invalid.
+    int fd_ {-1};
+    /// Number of bytes in image_.
+    size_t size_ {0};
+    /// Contents of the file.
+    std::unique_ptr<uint8_t[]> image_;
+};
+
 ///
 /// Base class for individual configuration entries. Defines helper methods for
 /// reading and writing.
@@ -56,6 +56,8 @@ void ConfigUpdateFlow::init_flow()
 
 void ConfigUpdateFlow::factory_reset()
 {
+    // Factory reset rewrites the file behind the snapshot.
+    snapshotStale_ = 1;
     for (auto it = listeners_.begin(); it != listeners_.end(); ++it) {
         it->factory_reset(fd_);
     }
@@ -37,7 +37,9 @@
 #ifndef _OPENLCB_CONFIGUPDATEFLOW_HXX_
 #define _OPENLCB_CONFIGUPDATEFLOW_HXX_
 
+#include "nmranet_config.h"
 #include "openmrn_features.h"
+#include "openlcb/ConfigEntry.hxx"
 #include "utils/ConfigUpdateListener.hxx"
 #include "utils/ConfigUpdateService.hxx"
 #include "openlcb/NodeInitializeFlow.hxx"
@@ -57,6 +59,10 @@ namespace openlcb
 /// to the registered ConfigUpdateListener descendants. This flow also handles
 /// any necessary action such as reboot or factory reset. This flow keeps the
 /// file descriptor for the config file that's currently open.
+///
+/// During an update pass the config file is read into memory once, and the
+/// config reads the listeners make from apply_configuration are served from
+/// that image (see ConfigSnapshot).
 class ConfigUpdateFlow : public StateFlowBase,
                          public ConfigUpdateService,
                          private Atomic
@@ -67,6 +73,7 @@ public:
         , nextRefresh_(listeners_.begin())
         , needsReboot_(0)
         , needsReInit_(0)
+        , snapshotStale_(1)
         , fd_(-1)
     {
     }
@@ -111,6 +118,8 @@ public:
         nextRefresh_ = listeners_.begin();
         needsReboot_ = 0;
         needsReInit_ = 0;
+        // The file was probably written to.
+        snapshotStale_ = 1;
         if (is_state(exit().next_state()))
         {
             start_flow(STATE(call_next_listener));
@@ -142,8 +151,19 @@ private:
             DIE("CONFIG_FILENAME not specified, or init() was not called, but "
                 "there are configuration listeners.");
         }
-        ConfigUpdateListener::UpdateAction action =
-            l->apply_configuration(fd_, is_initial, n_.reset(this));
+        if (snapshotStale_)
+        {
+            snapshotStale_ = 0;
+            if (config_config_update_snapshot_max_size() > 0)
+            {
+                snapshot_.load(fd_, config_config_update_snapshot_max_size());
+            }
+        }
+        ConfigUpdateListener::UpdateAction action;
+        {
+            ConfigSnapshot::Activate a(&snapshot_);
+            action = l->apply_configuration(fd_, is_initial, n_.reset(this));
+        }
         switch (action)
         {
             case ConfigUpdateListener::UPDATED:
@@ -184,6 +204,8 @@ private:
 
     Action apply_action()
     {
+        snapshot_.clear();
+        snapshotStale_ = 1;
         /// TODO(balazs.racz) apply the changes reported.
         if (needsReboot_)
         {
@@ -211,7 +233,11 @@ private:
     unsigned needsReboot_ : 1;
     /// did anybody request a node reinit to happen?
     unsigned needsReInit_ : 1;
+    /// 1 if snapshot_ needs to be reloaded before calling the next listener.
+    unsigned snapshotStale_ : 1;
     int fd_;
+    /// Contents of the config file during an update pass.
+    ConfigSnapshot snapshot_;
     BarrierNotifiable n_;
 };
 
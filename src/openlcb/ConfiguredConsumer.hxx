@@ -232,8 +232,7 @@ private:
         {
             mti++; // INVALID
         }
-        event->event_write_helper<3>()->WriteAsync(
-            node_, mti, WriteHelper::global(), eventid_to_buffer(event_), done);
+        event->send_identified<3>(node_, mti, event_, done);
     }
 
     void handle_identify_consumer(const EventRegistryEntry &registry_entry,
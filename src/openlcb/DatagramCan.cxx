@@ -37,6 +37,7 @@
 #include "openlcb/DatagramDefs.hxx"
 #include "openlcb/DatagramImpl.hxx"
 #include "openlcb/IfCanImpl.hxx"
+#include "nmranet_config.h"
 
 namespace openlcb
 {
@@ -162,7 +163,7 @@ public:
 
         srcAlias_ = (id & CanDefs::SRC_MASK) >> CanDefs::SRC_SHIFT;
 
-        uint64_t buffer_key = id & (CanDefs::DST_MASK | CanDefs::SRC_MASK);
+        uint32_t buffer_key = id & (CanDefs::DST_MASK | CanDefs::SRC_MASK);
 
         dst_.alias = buffer_key >> (CanDefs::DST_SHIFT);
         dstNode_ = nullptr;
@@ -179,6 +180,8 @@ public:
 
         DatagramPayload *buf = nullptr;
         bool last_frame = true;
+        // true if buf holds a multi-frame datagram taken from a slot.
+        bool reassembled = false;
 
         switch (can_frame_type)
         {
@@ -192,10 +195,10 @@ public:
             case 3:
             {
                 // Datagram first frame
-                auto it = pendingBuffers_.find(buffer_key);
-                if (it != pendingBuffers_.end())
+                Reassembly *r = find_slot(buffer_key);
+                if (r)
                 {
-                    pendingBuffers_.erase(it);
+                    release_slot(r);
                     /** Frames came out of order or more than one datagram is
                      * being sent to the same dst. */
                     errorCode_ = DatagramClient::RESEND_OK |
@@ -203,11 +206,8 @@ public:
                     break;
                 }
 
-                buf = &pendingBuffers_[buffer_key];
-                buf->clear();
-
-                // Datagram first frame. Get a full buffer.
-                buf->reserve(72);
+                r = allocate_slot(buffer_key);
+                buf = &r->data_;
                 last_frame = false;
                 break;
             }
@@ -218,18 +218,23 @@ public:
             case 5:
             {
                 // Datagram last frame
-                auto it = pendingBuffers_.find(buffer_key);
-                if (it != pendingBuffers_.end())
+                Reassembly *r = find_slot(buffer_key);
+                if (r)
                 {
-                    buf = &it->second;
+                    buf = &r->data_;
                     if (last_frame)
                     {
-                        localBuffer_.clear();
-                        // Moves ownership of the allocated data to the local
-                        // buffer.
-                        localBuffer_.swap(*buf);
+                        // Copies the data out so that the slot keeps its
+                        // preallocated buffer. The local buffer is handed
+                        // over to the message.
+                        localBuffer_ = r->data_;
                         buf = &localBuffer_;
-                        pendingBuffers_.erase(it);
+                        release_slot(r);
+                        reassembled = true;
+                    }
+                    else
+                    {
+                        touch_slot(r);
                     }
                 }
                 break;
@@ -252,9 +257,12 @@ public:
                 (int)(buf->size() + f->can_dlc));
             errorCode_ = DatagramClient::PERMANENT_ERROR;
             // Since we reject the datagram, let's not keep the buffer
-            // around. This call should not crash if the buffer was already
-            // deleted.
-            pendingBuffers_.erase(buffer_key);
+            // around. The slot might have been released already.
+            Reassembly *r = find_slot(buffer_key);
+            if (r)
+            {
+                release_slot(r);
+            }
         }
 
         if (errorCode_)
@@ -271,6 +279,10 @@ public:
         if (last_frame)
         {
             HASSERT(buf == &localBuffer_);
+            if (reassembled)
+            {
+                ++stats_.completed;
+            }
             // Datagram is complete; let's send it to higher level If.
             return allocate_and_call(if_can()->dispatcher(),
                                      STATE(datagram_complete));
@@ -322,7 +334,156 @@ public:
         return exit();
     }
 
+    /// @return the reassembly counters.
+    const DatagramReassemblyStats &stats()
+    {
+        return stats_;
+    }
+
 private:
+    /// One entry of the reassembly pool.
+    struct Reassembly
+    {
+        /// Source and destination alias bits of the CAN frame ID. Zero if the
+        /// slot is free (the destination is always a valid local alias).
+        uint32_t key_ {0};
+        /// OSTime::get_monotonic() after which the entry is released.
+        long long deadline_;
+        /// Payload received so far.
+        DatagramPayload data_;
+    };
+
+    /// Timer that releases the reassembly slots that did not receive a frame
+    /// for a while.
+    class ExpiryTimer : public ::Timer
+    {
+    public:
+        ExpiryTimer(CanDatagramParser *parent)
+            : ::Timer(parent->service()->executor()->active_timers())
+            , parent_(parent)
+        {
+        }
+
+        long long timeout() override
+        {
+            return parent_->expire_slots();
+        }
+
+    private:
+        /// Owning flow.
+        CanDatagramParser *parent_;
+    };
+
+    /// Looks up a pending reassembly. @param key source and destination
+    /// alias bits of the frame. @return slot or nullptr if not found.
+    Reassembly *find_slot(uint32_t key)
+    {
+        for (unsigned i = 0; i < numSlots_; ++i)
+        {
+            if (slots_[i].key_ == key)
+            {
+                return &slots_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    /// Takes a free slot for a new reassembly. If all slots are busy, the
+    /// least recently used one gets dropped. @param key source and
+    /// destination alias bits of the frame. @return the slot, with an empty
+    /// payload.
+    Reassembly *allocate_slot(uint32_t key)
+    {
+        Reassembly *r = nullptr;
+        for (unsigned i = 0; i < numSlots_; ++i)
+        {
+            if (!slots_[i].key_)
+            {
+                r = &slots_[i];
+                break;
+            }
+            if (!r || slots_[i].deadline_ < r->deadline_)
+            {
+                r = &slots_[i];
+            }
+        }
+        if (r->key_)
+        {
+            LOG(INFO, "AsyncDatagramCan: dropping partial datagram from "
+                      "alias %03x.",
+                (unsigned)((r->key_ & CanDefs::SRC_MASK) >>
+                    CanDefs::SRC_SHIFT));
+            ++stats_.dropped;
+        }
+        r->key_ = key;
+        r->data_.clear();
+        touch_slot(r);
+        return r;
+    }
+
+    /// Extends the deadline of a slot after a frame arrived for it, and makes
+    /// sure the expiry timer is running. @param r the slot.
+    void touch_slot(Reassembly *r)
+    {
+        r->deadline_ = OSTime::get_monotonic() +
+            MSEC_TO_NSEC(config_datagram_reassembly_timeout_msec());
+        if (!timerRunning_)
+        {
+            timerRunning_ = true;
+            timer_.start_absolute(r->deadline_);
+        }
+    }
+
+    /// Frees a slot after its datagram was completed or rejected. Stops the
+    /// expiry timer if no other slot is busy, so that it does not keep the
+    /// executor's timers busy for nothing. @param r the slot.
+    void release_slot(Reassembly *r)
+    {
+        r->key_ = 0;
+        for (unsigned i = 0; i < numSlots_; ++i)
+        {
+            if (slots_[i].key_)
+            {
+                return;
+            }
+        }
+        // The timeout callback will find no busy slots and stop the timer.
+        timer_.ensure_triggered();
+    }
+
+    /// Releases the slots whose deadline passed. Called by the timer.
+    /// @return the timer period until the next deadline, or NONE if there are
+    /// no pending reassemblies.
+    long long expire_slots()
+    {
+        long long now = OSTime::get_monotonic();
+        long long next = INT64_MAX;
+        for (unsigned i = 0; i < numSlots_; ++i)
+        {
+            Reassembly *r = &slots_[i];
+            if (!r->key_)
+            {
+                continue;
+            }
+            if (r->deadline_ <= now)
+            {
+                r->key_ = 0;
+                ++stats_.expired;
+            }
+            else if (r->deadline_ < next)
+            {
+                next = r->deadline_;
+            }
+        }
+        if (next == INT64_MAX)
+        {
+            timerRunning_ = false;
+            return ::Timer::NONE;
+        }
+        // Values 0 and 1 have special meaning for the timer.
+        return std::max(next - now, 2LL);
+    }
+
     /// A local buffer that owns the datagram payload bytes after we took the
     /// entry from the pending buffers map.
     DatagramPayload localBuffer_;
@@ -334,19 +495,25 @@ private:
     /// be forwarded to the upper layer in this case.
     uint16_t errorCode_;
 
-    /** Open datagram buffers. Keyed by (dstid | srcid), value is a datagram
-     * payload. When a payload is finished, it should be moved into the final
-     * datagram message using swap() to avoid memory copies.
-     * @TODO(balazs.racz) we need some kind of timeout-based release mechanism
-     * in here. */
-    StlMap<uint64_t, DatagramPayload> pendingBuffers_;
+    /// true if timer_ is scheduled.
+    bool timerRunning_ {false};
+    /// Number of entries in slots_.
+    unsigned numSlots_;
+    /// Pool of the open datagram buffers. Each entry has a 72-byte payload
+    /// reserved up front.
+    std::unique_ptr<Reassembly[]> slots_;
+    /// Releases the stale entries of slots_.
+    ExpiryTimer timer_ {this};
+    /// Reassembly counters.
+    DatagramReassemblyStats stats_;
 };
 CanDatagramService::CanDatagramService(IfCan *iface,
                                        int num_registry_entries,
                                        int num_clients)
     : DatagramService(iface, num_registry_entries)
 {
-    if_can()->add_owned_flow(new CanDatagramParser(if_can()));
+    parser_ = new CanDatagramParser(if_can());
+    if_can()->add_owned_flow(parser_);
     auto* dg_send = new CanDatagramWriteFlow(if_can());
     if_can()->add_owned_flow(dg_send);
     for (int i = 0; i < num_clients; ++i)
@@ -357,18 +524,35 @@ CanDatagramService::CanDatagramService(IfCan *iface,
     }
 }
 
-Executable *TEST_CreateCanDatagramParser(IfCan *if_can)
+Executable *TEST_CreateCanDatagramParser(
+    IfCan *if_can, const DatagramReassemblyStats **stats)
 {
-    return new CanDatagramParser(if_can);
+    auto *p = new CanDatagramParser(if_can);
+    if (stats)
+    {
+        *stats = &p->stats();
+    }
+    return p;
 }
 
 CanDatagramService::~CanDatagramService()
 {
 }
 
+const DatagramReassemblyStats &CanDatagramService::reassembly_stats()
+{
+    return parser_->stats();
+}
+
 CanDatagramParser::CanDatagramParser(IfCan *iface)
     : CanFrameStateFlow(iface)
+    , numSlots_(std::max(config_num_datagram_reassembly_buffers(), 1))
+    , slots_(new Reassembly[numSlots_])
 {
+    for (unsigned i = 0; i < numSlots_; ++i)
+    {
+        slots_[i].data_.reserve(DatagramDefs::MAX_SIZE);
+    }
     if_can()->frame_dispatcher()->register_handler(this,
         CAN_FILTER |
             (CanDefs::DATAGRAM_ONE_FRAME << CanDefs::CAN_FRAME_TYPE_SHIFT),
@@ -386,6 +570,10 @@ CanDatagramParser::CanDatagramParser(IfCan *iface)
 CanDatagramParser::~CanDatagramParser()
 {
     if_can()->frame_dispatcher()->unregister_handler_all(this);
+    if (timerRunning_)
+    {
+        timer_.cancel();
+    }
 }
 
 } // namespace openlcb
@@ -41,6 +41,19 @@
 namespace openlcb
 {
 
+class CanDatagramParser;
+
+/// Counters of the incoming multi-frame datagram reassembly.
+struct DatagramReassemblyStats
+{
+    /// Multi-frame datagrams that were completely received.
+    unsigned completed {0};
+    /// Partial datagrams that were evicted to make room for a new one.
+    unsigned dropped {0};
+    /// Partial datagrams that were released due to a timeout.
+    unsigned expired {0};
+};
+
 /// Implementation of the DatagramService with the CANbus-specific OpenLCB
 /// datagram protocol. This service is responsible for fragmenting outgoing
 /// datagram messages to the CANbus, assembling incoming datagram frames into
@@ -61,10 +74,22 @@ public:
     {
         return static_cast<IfCan *>(iface());
     }
+
+    /// @return counters of the incoming datagram reassembly. Must be read on
+    /// the interface's executor.
+    const DatagramReassemblyStats &reassembly_stats();
+
+private:
+    /// Assembles incoming datagram frames. Owned by the interface.
+    CanDatagramParser *parser_;
 };
 
 /// Creates a CAN datagram parser flow. Exposed for testing only.
-Executable *TEST_CreateCanDatagramParser(IfCan *if_can);
+/// @param if_can the interface to listen on.
+/// @param stats if not null, will be set to point to the counters of the
+/// parser.
+Executable *TEST_CreateCanDatagramParser(
+    IfCan *if_can, const DatagramReassemblyStats **stats = nullptr);
 
 } // namespace openlcb
 
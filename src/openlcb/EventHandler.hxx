@@ -48,6 +48,7 @@ namespace openlcb
 typedef uint64_t EventId;
 class Node;
 class EventHandler;
+class EventIdentifyBatch;
 
 /*enum EventMask {
   EVENT_EXACT_MASK = 1,
@@ -91,12 +92,39 @@ struct EventReport
         return write_helpers + (N - 1);
     }
 
+    /// Sends a global event message, typically Producer or Consumer
+    /// Identified, in response to this report. While the event service is
+    /// answering an Identify Global or Identify Events message with batching
+    /// enabled, the message is added to the batch and done is notified
+    /// immediately. Otherwise event_write_helper<N> is used.
+    /// @param node the originating node.
+    /// @param mti the message to send.
+    /// @param event_id the event ID in the message payload.
+    /// @param done will be notified when the message is enqueued.
+    template <int N>
+    void send_identified(
+        Node *node, Defs::MTI mti, EventId event_id, Notifiable *done)
+    {
+        if (identifyBatch_ && add_to_batch(node, mti, event_id))
+        {
+            done->notify();
+            return;
+        }
+        event_write_helper<N>()->WriteAsync(
+            node, mti, WriteHelper::global(), eventid_to_buffer(event_id), done);
+    }
+
     /// Public constructor for use in tests only.
     EventReport(TestingEnum)
     {
     }
 
 private:
+    /// Appends a message to identifyBatch_. @param node originating
+    /// node. @param mti message. @param event_id payload. @return false if
+    /// the batch is full.
+    bool add_to_batch(Node *node, Defs::MTI mti, EventId event_id);
+
     /// Constrained access to the constructors. We do this because the
     /// EventReport structure is pretty expensive due to the statically
     /// allocated memory of the write helpers. Only the EventIteratorFlow
@@ -107,6 +135,10 @@ private:
 
     /// Static objects usable by all event handler implementations.
     WriteHelper write_helpers[4];
+
+    /// If not null, identified messages are collected here instead of being
+    /// sent one by one.
+    EventIdentifyBatch *identifyBatch_ {nullptr};
 };
 
 /// Structure used in registering event handlers.
@@ -160,4 +160,299 @@ TreeEventHandlers::TreeEventHandlers()
 {
 }
 
+constexpr uint32_t HashEventHandlers::NONE;
+
+HashEventHandlers::HashEventHandlers()
+{
+}
+
+unsigned HashEventHandlers::find_slot(EventId event)
+{
+    unsigned m = slots_.size() - 1;
+    // Fibonacci hashing; event IDs usually differ only in the low bits.
+    unsigned i = ((event * 0x9E3779B97F4A7C15ULL) >> 32) & m;
+    while (slots_[i] != NONE && entries_[slots_[i]].event != event)
+    {
+        i = (i + 1) & m;
+    }
+    return i;
+}
+
+void HashEventHandlers::index_entry(uint32_t idx)
+{
+    unsigned slot = find_slot(entries_[idx].event);
+    if (slots_[slot] == NONE)
+    {
+        slots_[slot] = idx;
+        return;
+    }
+    uint32_t tail = slots_[slot];
+    while (next_[tail] != NONE)
+    {
+        tail = next_[tail];
+    }
+    next_[tail] = idx;
+}
+
+void HashEventHandlers::rehash(size_t size)
+{
+    slots_.assign(size, NONE);
+    next_.assign(entries_.size(), NONE);
+    for (uint32_t i = 0; i < entries_.size(); ++i)
+    {
+        index_entry(i);
+    }
+}
+
+void HashEventHandlers::register_handler(
+    const EventRegistryEntry &entry, unsigned mask)
+{
+    AtomicHolder h(this);
+    LOG(VERBOSE, "%p: register %p", this, entry.handler);
+    set_dirty();
+    if (mask == 0)
+    {
+        // Keeps the load factor at most 1/2.
+        if ((entries_.size() + 1) * 2 > slots_.size())
+        {
+            rehash(std::max(slots_.size() * 2, (size_t)16));
+        }
+        entries_.push_back(entry);
+        next_.push_back(NONE);
+        index_entry(entries_.size() - 1);
+        return;
+    }
+    auto b = std::lower_bound(ranges_.begin(), ranges_.end(), mask,
+        [](const RangeBucket &r, unsigned m) { return r.mask < m; });
+    if (b == ranges_.end() || b->mask != mask)
+    {
+        b = ranges_.insert(b, RangeBucket());
+        b->mask = mask;
+    }
+    auto it = std::upper_bound(b->entries.begin(), b->entries.end(),
+        entry.event, [](EventId e, const EventRegistryEntry &r) {
+            return e < r.event;
+        });
+    b->entries.insert(it, entry);
+}
+
+void HashEventHandlers::unregister_handler(
+    EventHandler *handler, uint32_t user_arg, uint32_t user_arg_mask)
+{
+    AtomicHolder h(this);
+    set_dirty();
+    LOG(VERBOSE, "%p: unregister %p", this, handler);
+    auto matches = [handler, user_arg, user_arg_mask](
+                       const EventRegistryEntry &e) {
+        return e.handler == handler &&
+            ((e.user_arg & user_arg_mask) == (user_arg & user_arg_mask));
+    };
+    auto erase_it = std::remove_if(entries_.begin(), entries_.end(), matches);
+    if (erase_it != entries_.end())
+    {
+        entries_.erase(erase_it, entries_.end());
+        rehash(slots_.size());
+    }
+    for (auto &r : ranges_)
+    {
+        r.entries.erase(std::remove_if(r.entries.begin(), r.entries.end(),
+                            matches),
+            r.entries.end());
+    }
+    ranges_.erase(std::remove_if(ranges_.begin(), ranges_.end(),
+                      [](const RangeBucket &r) { return r.entries.empty(); }),
+        ranges_.end());
+}
+
+void HashEventHandlers::reserve(size_t count)
+{
+    AtomicHolder h(this);
+    size_t total = entries_.size() + count;
+    entries_.reserve(total);
+    next_.reserve(total);
+    size_t size = std::max(slots_.size(), (size_t)16);
+    while (size < total * 2)
+    {
+        size *= 2;
+    }
+    if (size != slots_.size())
+    {
+        rehash(size);
+    }
+}
+
+/// Class representing the iteration state on the hash-based event handler
+/// registry.
+class HashEventHandlers::Iterator : public EventIterator
+{
+public:
+    Iterator(HashEventHandlers *parent)
+        : parent_(parent)
+    {
+        clear_iteration();
+    }
+
+    EventRegistryEntry *next_entry() OVERRIDE
+    {
+        AtomicHolder h(parent_);
+        auto &entries = parent_->entries_;
+        while (true)
+        {
+            switch (phase_)
+            {
+                case PROBE:
+                    if (chain_ != NONE)
+                    {
+                        EventRegistryEntry *e = &entries[chain_];
+                        chain_ = parent_->next_[chain_];
+                        return e;
+                    }
+                    if (!probesLeft_ || parent_->slots_.empty())
+                    {
+                        start_ranges();
+                        continue;
+                    }
+                    chain_ = parent_->slots_[parent_->find_slot(nextEvent_)];
+                    ++nextEvent_;
+                    --probesLeft_;
+                    continue;
+                case SCAN:
+                    while (pos_ < entries.size())
+                    {
+                        EventRegistryEntry *e = &entries[pos_++];
+                        if (e->event >= currentReport_->event &&
+                            e->event - currentReport_->event <=
+                                currentReport_->mask)
+                        {
+                            return e;
+                        }
+                    }
+                    start_ranges();
+                    continue;
+                case RANGES:
+                {
+                    if (bucket_ >= parent_->ranges_.size())
+                    {
+                        phase_ = DONE;
+                        continue;
+                    }
+                    auto &r = parent_->ranges_[bucket_].entries;
+                    if (pos_ < end_)
+                    {
+                        return &r[pos_++];
+                    }
+                    ++bucket_;
+                    setup_current_bucket();
+                    continue;
+                }
+                case DONE:
+                default:
+                    return nullptr;
+            }
+        }
+    }
+
+    void clear_iteration() OVERRIDE
+    {
+        phase_ = DONE;
+    }
+
+    void init_iteration(EventReport *r) OVERRIDE
+    {
+        AtomicHolder h(parent_);
+        currentReport_ = r;
+        if (r->mask < MAX_PROBES)
+        {
+            // Single event or a small range: looks up each event ID.
+            phase_ = PROBE;
+            chain_ = NONE;
+            nextEvent_ = r->event;
+            probesLeft_ = r->mask + 1;
+        }
+        else
+        {
+            phase_ = SCAN;
+            pos_ = 0;
+        }
+    }
+
+private:
+    /// Largest event range that is looked up in the hash table event by
+    /// event. Larger ranges scan all single event registrations.
+    static constexpr unsigned MAX_PROBES = 16;
+
+    /// Steps of the iteration.
+    enum Phase : uint8_t
+    {
+        /// Single events via the hash table.
+        PROBE,
+        /// Single events via scanning all entries.
+        SCAN,
+        /// Range registrations.
+        RANGES,
+        /// Iteration is over.
+        DONE
+    };
+
+    /// Moves to iterating the range registrations.
+    void start_ranges()
+    {
+        phase_ = RANGES;
+        bucket_ = 0;
+        setup_current_bucket();
+    }
+
+    /// Computes the matching section of the current range bucket.
+    void setup_current_bucket()
+    {
+        if (bucket_ >= parent_->ranges_.size())
+        {
+            return;
+        }
+        auto &b = parent_->ranges_[bucket_];
+        if (b.mask >= 64)
+        {
+            // 64 bits -> all events go to everyone.
+            pos_ = 0;
+            end_ = b.entries.size();
+            return;
+        }
+        auto cmp = [](const EventRegistryEntry &r, EventId e) {
+            return r.event < e;
+        };
+        uint64_t lower = currentReport_->event & ~((1ULL << b.mask) - 1);
+        uint64_t upper = currentReport_->event + currentReport_->mask;
+        pos_ = std::lower_bound(b.entries.begin(), b.entries.end(), lower,
+                   cmp) - b.entries.begin();
+        end_ = std::upper_bound(b.entries.begin(), b.entries.end(), upper,
+                   [](EventId e, const EventRegistryEntry &r) {
+                       return e < r.event;
+                   }) - b.entries.begin();
+    }
+
+    HashEventHandlers *parent_;
+    EventReport *currentReport_;
+    /// Next event ID to look up in the PROBE phase.
+    EventId nextEvent_;
+    /// How many more event IDs to look up in the PROBE phase.
+    uint64_t probesLeft_;
+    /// Next entry to return from the current chain in the PROBE phase.
+    uint32_t chain_;
+    /// Index of the current range bucket in the RANGES phase.
+    unsigned bucket_;
+    /// Next entry to look at in the SCAN and RANGES phases.
+    size_t pos_;
+    /// End of the matching entries in the current range bucket.
+    size_t end_;
+    /// Current step of the iteration.
+    Phase phase_;
+};
+
+constexpr unsigned HashEventHandlers::Iterator::MAX_PROBES;
+
+EventIterator *HashEventHandlers::create_iterator()
+{
+    return new Iterator(this);
+}
+
 } // namespace openlcb
@@ -187,6 +187,65 @@ private:
     MaskLookupMap handlers_;
 };
 
+/// EventRegistry implementation that keeps the handlers of single events in
+/// an open-addressed hash table, and the handlers of event ranges in one
+/// sorted list per range size. Looking up an incoming event report costs one
+/// hash probe plus one binary search per range size in use, independent of
+/// how many single events are registered.
+class HashEventHandlers : public EventRegistry, private Atomic
+{
+public:
+    HashEventHandlers();
+
+    EventIterator *create_iterator() OVERRIDE;
+    void register_handler(const EventRegistryEntry &entry,
+                          unsigned mask) OVERRIDE;
+    void unregister_handler(EventHandler *handler, uint32_t user_arg = 0,
+        uint32_t user_arg_mask = 0) OVERRIDE;
+    void reserve(size_t count) OVERRIDE;
+
+private:
+    class Iterator;
+    friend class Iterator;
+
+    /// Marks an empty hash slot or the end of a chain.
+    static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+    /// Handlers registered for ranges of a given size.
+    struct RangeBucket
+    {
+        /// log2 of the range size (the mask argument of register_handler).
+        unsigned mask;
+        /// Registrations, sorted by event.
+        std::vector<EventRegistryEntry> entries;
+    };
+
+    /// Finds the hash slot of an event ID. slots_ must not be empty.
+    /// @param event the event ID to look for.
+    /// @return index in slots_ that is either NONE or the head of the chain
+    /// of event.
+    unsigned find_slot(EventId event);
+
+    /// Adds an entry to the end of the chain of its event ID.
+    /// @param idx index of the entry in entries_.
+    void index_entry(uint32_t idx);
+
+    /// Rebuilds the hash index. @param size new number of slots, a power of
+    /// two.
+    void rehash(size_t size);
+
+    /// Handlers registered for a single event, in registration order.
+    std::vector<EventRegistryEntry> entries_;
+    /// For each entry in entries_, the index of the next entry with the same
+    /// event ID, or NONE.
+    std::vector<uint32_t> next_;
+    /// Hash table with linear probing. Each slot is NONE or the index of the
+    /// first entry in entries_ of an event ID.
+    std::vector<uint32_t> slots_;
+    /// Range registrations, sorted by mask.
+    std::vector<RangeBucket> ranges_;
+};
+
 }; /* namespace openlcb */
 
 #endif  // _OPENLCB_EVENTHANDLERCONTAINER_HXX_
@@ -233,8 +233,7 @@ void BitRangeEventPC::HandleIdentifyBase(Defs::MTI mti_valid,
         mti++; // mti INVALID
     }
 
-    event->event_write_helper<1>()->WriteAsync(node_, mti,
-        WriteHelper::global(), eventid_to_buffer(event->event), done);
+    event->send_identified<1>(node_, mti, event->event, done);
 }
 
 uint64_t EncodeRange(uint64_t begin, unsigned size)
@@ -268,12 +267,10 @@ void BitRangeEventPC::handle_identify_global(const EventRegistryEntry& entry, Ev
         return done->notify();
     }
     uint64_t range = EncodeRange(event_base_, size_ * 2);
-    event->event_write_helper<1>()->WriteAsync(node_,
-        Defs::MTI_PRODUCER_IDENTIFIED_RANGE, WriteHelper::global(),
-        eventid_to_buffer(range), done->new_child());
-    event->event_write_helper<2>()->WriteAsync(node_,
-        Defs::MTI_CONSUMER_IDENTIFIED_RANGE, WriteHelper::global(),
-        eventid_to_buffer(range), done->new_child());
+    event->send_identified<1>(
+        node_, Defs::MTI_PRODUCER_IDENTIFIED_RANGE, range, done->new_child());
+    event->send_identified<2>(
+        node_, Defs::MTI_CONSUMER_IDENTIFIED_RANGE, range, done->new_child());
     done->maybe_done();
 }
 
@@ -294,9 +291,8 @@ void BitRangeEventP::handle_identify_global(const EventRegistryEntry& entry,
         return done->notify();
     }
     uint64_t range = EncodeRange(event_base_, size_ * 2);
-    event->event_write_helper<1>()->WriteAsync(node_,
-        Defs::MTI_PRODUCER_IDENTIFIED_RANGE, WriteHelper::global(),
-        eventid_to_buffer(range), done->new_child());
+    event->send_identified<1>(
+        node_, Defs::MTI_PRODUCER_IDENTIFIED_RANGE, range, done->new_child());
     done->maybe_done();
 }
 
@@ -368,8 +364,7 @@ void ByteRangeEventC::handle_identify_consumer(const EventRegistryEntry& entry,
     {
         mti++; // mti INVALID
     }
-    event->event_write_helper<1>()->WriteAsync(node_, mti,
-        WriteHelper::global(), eventid_to_buffer(event->event), done);
+    event->send_identified<1>(node_, mti, event->event, done);
 }
 
 void ByteRangeEventC::handle_identify_global(const EventRegistryEntry& entry, EventReport *event,
@@ -380,9 +375,8 @@ void ByteRangeEventC::handle_identify_global(const EventRegistryEntry& entry, Ev
         return done->notify();
     }
     uint64_t range = EncodeRange(event_base_, size_ * 256);
-    event->event_write_helper<1>()->WriteAsync(node_,
-        Defs::MTI_CONSUMER_IDENTIFIED_RANGE, WriteHelper::global(),
-        eventid_to_buffer(range), done->new_child());
+    event->send_identified<1>(
+        node_, Defs::MTI_CONSUMER_IDENTIFIED_RANGE, range, done->new_child());
     done->maybe_done();
 }
 
@@ -435,9 +429,7 @@ void ByteRangeEventP::handle_identify_producer(const EventRegistryEntry& entry,
         Update(
             storage - data_, event->event_write_helper<2>(), done->new_child());
     }
-    event->event_write_helper<1>()->WriteAsync(node_, mti,
-        WriteHelper::global(), eventid_to_buffer(event->event),
-        done->new_child());
+    event->send_identified<1>(node_, mti, event->event, done->new_child());
     done->maybe_done();
 }
 void ByteRangeEventP::handle_identify_global(const EventRegistryEntry& entry, EventReport *event,
@@ -448,9 +440,8 @@ void ByteRangeEventP::handle_identify_global(const EventRegistryEntry& entry, Ev
         return done->notify();
     }
     uint64_t range = EncodeRange(event_base_, size_ * 256);
-    event->event_write_helper<1>()->WriteAsync(node_,
-        Defs::MTI_PRODUCER_IDENTIFIED_RANGE, WriteHelper::global(),
-        eventid_to_buffer(range), done);
+    event->send_identified<1>(
+        node_, Defs::MTI_PRODUCER_IDENTIFIED_RANGE, range, done);
 }
 
 void ByteRangeEventP::SendIdentified(WriteHelper *writer,
@@ -577,13 +568,11 @@ void BitEventHandler::SendProducerIdentified(
 {
     EventState state = bit_->get_current_state();
     Defs::MTI mti = Defs::MTI_PRODUCER_IDENTIFIED_VALID + state;
-    event->event_write_helper<1>()->WriteAsync(bit_->node(), mti,
-        WriteHelper::global(), eventid_to_buffer(bit_->event_on()),
-        done->new_child());
+    event->send_identified<1>(
+        bit_->node(), mti, bit_->event_on(), done->new_child());
     mti = Defs::MTI_PRODUCER_IDENTIFIED_VALID + invert_event_state(state);
-    event->event_write_helper<2>()->WriteAsync(bit_->node(), mti,
-        WriteHelper::global(), eventid_to_buffer(bit_->event_off()),
-        done->new_child());
+    event->send_identified<2>(
+        bit_->node(), mti, bit_->event_off(), done->new_child());
 }
 
 void BitEventHandler::SendConsumerIdentified(
@@ -591,13 +580,11 @@ void BitEventHandler::SendConsumerIdentified(
 {
     EventState state = bit_->get_current_state();
     Defs::MTI mti = Defs::MTI_CONSUMER_IDENTIFIED_VALID + state;
-    event->event_write_helper<3>()->WriteAsync(bit_->node(), mti,
-        WriteHelper::global(), eventid_to_buffer(bit_->event_on()),
-        done->new_child());
+    event->send_identified<3>(
+        bit_->node(), mti, bit_->event_on(), done->new_child());
     mti = Defs::MTI_CONSUMER_IDENTIFIED_VALID + invert_event_state(state);
-    event->event_write_helper<4>()->WriteAsync(bit_->node(), mti,
-        WriteHelper::global(), eventid_to_buffer(bit_->event_off()),
-        done->new_child());
+    event->send_identified<4>(
+        bit_->node(), mti, bit_->event_off(), done->new_child());
 }
 
 void BitEventHandler::SendEventReport(WriteHelper *writer, Notifiable *done)
@@ -642,8 +629,7 @@ void BitEventHandler::HandlePCIdentify(Defs::MTI mti, EventReport *event,
         return;
     }
     mti = mti + active;
-    event->event_write_helper<1>()->WriteAsync(bit_->node(), mti,
-        WriteHelper::global(), eventid_to_buffer(event->event), done);
+    event->send_identified<1>(bit_->node(), mti, event->event, done);
 }
 
 void BitEventConsumer::handle_producer_identified(const EventRegistryEntry& entry, EventReport *event,
@@ -151,9 +151,8 @@ public:
         {
             return done->notify();
         }
-        event->event_write_helper<1>()->WriteAsync(node_,
-            openlcb::Defs::MTI_PRODUCER_IDENTIFIED_UNKNOWN,
-            WriteHelper::global(), openlcb::eventid_to_buffer(EVENT_ID), done);
+        event->send_identified<1>(node_,
+            openlcb::Defs::MTI_PRODUCER_IDENTIFIED_UNKNOWN, EVENT_ID, done);
     }
 
     void handle_identify_producer(const EventRegistryEntry &registry_entry, EventReport *event, BarrierNotifiable *done)
@@ -20,18 +20,20 @@ namespace openlcb
 /*static*/
 EventService *EventService::instance = nullptr;
 
-EventService::EventService(ExecutorBase *e) : Service(e)
+EventService::EventService(ExecutorBase *e, RegistryType registry_type)
+    : Service(e)
 {
     HASSERT(instance == nullptr);
     instance = this;
-    impl_.reset(new Impl(this));
+    impl_.reset(new Impl(this, registry_type));
 }
 
-EventService::EventService(If *iface) : Service(iface->executor())
+EventService::EventService(If *iface, RegistryType registry_type)
+    : Service(iface->executor())
 {
     HASSERT(instance == nullptr);
     instance = this;
-    impl_.reset(new Impl(this));
+    impl_.reset(new Impl(this, registry_type));
     register_interface(iface);
 }
 
@@ -54,13 +56,26 @@ void EventService::register_interface(If *iface)
         EventService::Impl::MTI_MASK_ADDRESSED_ALL));
 }
 
-EventService::Impl::Impl(EventService *service) : callerFlow_(service)
+EventService::Impl::Impl(EventService *service, RegistryType registry_type)
+    : callerFlow_(service)
 {
+    switch (registry_type)
+    {
+        case REGISTRY_HASH:
+            registry.reset(new HashEventHandlers());
+            break;
+        case REGISTRY_TREE:
+            registry.reset(new TreeEventHandlers());
+            break;
+        case REGISTRY_DEFAULT:
+        default:
 #ifdef TARGET_LPC11Cxx
-    registry.reset(new VectorEventHandlers());
+            registry.reset(new VectorEventHandlers());
 #else
-    registry.reset(new TreeEventHandlers());
+            registry.reset(new TreeEventHandlers());
 #endif
+            break;
+    }
 }
 
 EventService::Impl::~Impl()
@@ -136,6 +151,7 @@ StateFlowBase::Action EventIteratorFlow::entry()
     currentProcessStart_ = os_get_time_monotonic();
 #endif
     EventReport *rep = &eventReport_;
+    rep->identifyBatch_ = nullptr;
     rep->src_node = nmsg()->src;
     rep->dst_node = nmsg()->dstNode;
     if ((nmsg()->mti & Defs::MTI_EVENT_MASK) == Defs::MTI_EVENT_MASK)
@@ -218,6 +234,16 @@ StateFlowBase::Action EventIteratorFlow::entry()
         // fall through
         case Defs::MTI_EVENTS_IDENTIFY_GLOBAL:
             fn_ = &EventHandler::handle_identify_global;
+            if (config_event_identify_batch_size() > 0)
+            {
+                if (!identifyBatch_)
+                {
+                    identifyBatch_.reset(new EventIdentifyBatch(eventService_,
+                        std::max((unsigned)config_event_identify_batch_size(),
+                            MAX_MESSAGES_PER_HANDLER)));
+                }
+                rep->identifyBatch_ = identifyBatch_.get();
+            }
             // Reduces the priority so that we let the priority 3 event messages
             // be processed before the global identify events makes any
             // progress.
@@ -248,7 +274,22 @@ StateFlowBase::Action EventIteratorFlow::iterate_next()
         iterator_->init_iteration(&eventReport_);
     }
 
+    EventIdentifyBatch *batch = eventReport_.identifyBatch_;
+    if (batch && batch->space() < MAX_MESSAGES_PER_HANDLER)
+    {
+        // Makes room for the next event handler's messages.
+        n_.reset(this);
+        batch->flush(&n_);
+        return wait_and_call(STATE(iterate_next));
+    }
+
     EventRegistryEntry *entry = iterator_->next_entry();
+    if (!entry && batch && !batch->empty())
+    {
+        n_.reset(this);
+        batch->flush(&n_);
+        return wait_and_call(STATE(iterate_next));
+    }
     if (!entry)
     {
         if (incomingDone_)
@@ -279,6 +320,12 @@ StateFlowBase::Action EventIteratorFlow::iterate_next()
 
 StateFlowBase::Action EventIteratorFlow::dispatch_event(const EventRegistryEntry *entry)
 {
+    if (eventReport_.identifyBatch_)
+    {
+        // The handlers do not need the write helpers, so there is no need to
+        // serialize them with the EventCallerFlow.
+        return dispatch_inline(entry);
+    }
     Buffer<EventHandlerCall> *b;
     /* This could be made an asynchronous allocation. Then the pool could be
      * made fixed size. */
@@ -291,8 +338,80 @@ StateFlowBase::Action EventIteratorFlow::dispatch_event(const EventRegistryEntry
     return wait();
 }
 
+constexpr unsigned EventIteratorFlow::MAX_MESSAGES_PER_HANDLER;
+
+bool EventReport::add_to_batch(Node *node, Defs::MTI mti, EventId event_id)
+{
+    return identifyBatch_->add(node, mti, event_id);
+}
+
+EventIdentifyBatch::EventIdentifyBatch(Service *service, unsigned capacity)
+    : StateFlowBase(service)
+    , entries_(new Entry[capacity])
+    , capacity_(capacity)
+{
+}
+
+bool EventIdentifyBatch::add(Node *node, Defs::MTI mti, EventId event_id)
+{
+    if (count_ >= capacity_)
+    {
+        return false;
+    }
+    Entry &e = entries_[count_++];
+    e.node = node;
+    e.eventId = event_id;
+    e.mti = mti;
+    return true;
+}
+
+void EventIdentifyBatch::flush(Notifiable *done)
+{
+    done_ = done;
+    next_ = 0;
+    bn_.reset(this);
+    start_flow(STATE(send_next));
+}
+
+StateFlowBase::Action EventIdentifyBatch::send_next()
+{
+    // Same as the WriteHelper: nodes that are not initialized yet do not
+    // send anything.
+    while (next_ < count_ &&
+        (!entries_[next_].node || !entries_[next_].node->is_initialized()))
+    {
+        ++next_;
+    }
+    if (next_ >= count_)
+    {
+        bn_.notify();
+        return wait_and_call(STATE(all_sent));
+    }
+    return allocate_and_call(
+        entries_[next_].node->iface()->global_message_write_flow(),
+        STATE(fill_message));
+}
+
+StateFlowBase::Action EventIdentifyBatch::fill_message()
+{
+    Entry &e = entries_[next_++];
+    auto *f = e.node->iface()->global_message_write_flow();
+    auto *b = get_allocation_result(f);
+    b->data()->reset(e.mti, e.node->node_id(), eventid_to_buffer(e.eventId));
+    b->set_done(bn_.new_child());
+    f->send(b, b->data()->priority());
+    return call_immediately(STATE(send_next));
+}
+
+StateFlowBase::Action EventIdentifyBatch::all_sent()
+{
+    count_ = 0;
+    done_->notify();
+    return exit();
+}
+
 StateFlowBase::Action
-InlineEventIteratorFlow::dispatch_event(const EventRegistryEntry *entry)
+EventIteratorFlow::dispatch_inline(const EventRegistryEntry *entry)
 {
     currentEntry_ = entry;
     if (eventRegistryEpoch_ != eventService_->impl()->registry->get_epoch())
@@ -67,11 +67,28 @@ class EventIteratorFlow;
 class EventService : public Service
 {
 public:
-    /** Creates a global event service with no interfaces registered. */
-    EventService(ExecutorBase *e);
+    /// Selects the data structure of the event registry.
+    enum RegistryType
+    {
+        /// TreeEventHandlers, or VectorEventHandlers on the smallest MCUs.
+        REGISTRY_DEFAULT,
+        /// Sorted list per registration mask (TreeEventHandlers).
+        REGISTRY_TREE,
+        /// Hash table for single events (HashEventHandlers). Best for nodes
+        /// with many individually registered events.
+        REGISTRY_HASH,
+    };
+
+    /** Creates a global event service with no interfaces registered.
+     * @param e the executor to run on.
+     * @param registry_type which event registry implementation to use. */
+    EventService(
+        ExecutorBase *e, RegistryType registry_type = REGISTRY_DEFAULT);
     /** Creates a global event service that runs on an interface's thread and
-     * registers the interface. */
-    EventService(If *iface);
+     * registers the interface.
+     * @param iface the interface to register.
+     * @param registry_type which event registry implementation to use. */
+    EventService(If *iface, RegistryType registry_type = REGISTRY_DEFAULT);
     ~EventService();
 
     /** Registers this global event handler with an interface. This operation
@@ -87,13 +87,82 @@ private:
     BarrierNotifiable n_;
 };
 
+/// Collects the Producer/Consumer Identified messages that event handlers
+/// produce while answering an Identify Global or addressed Identify Events
+/// message, and sends them out in batches. The storage is allocated once;
+/// one batch is sent completely before the event handlers are invoked
+/// again, which bounds the number of messages in flight.
+class EventIdentifyBatch : public StateFlowBase
+{
+public:
+    /// Constructor. @param service defines the executor to run
+    /// on. @param capacity how many messages to collect before sending.
+    EventIdentifyBatch(Service *service, unsigned capacity);
+
+    /// Appends a message to the batch. @param node the originating
+    /// node. @param mti message. @param event_id payload. @return false if
+    /// the batch is full.
+    bool add(Node *node, Defs::MTI mti, EventId event_id);
+
+    /// @return how many more messages can be added.
+    unsigned space()
+    {
+        return capacity_ - count_;
+    }
+
+    /// @return true if there are no messages in the batch.
+    bool empty()
+    {
+        return count_ == 0;
+    }
+
+    /// Sends out the messages in the batch. Must not be called while a
+    /// previous flush is in progress. @param done will be notified when all
+    /// messages are enqueued to the interfaces.
+    void flush(Notifiable *done);
+
+private:
+    /// One collected message.
+    struct Entry
+    {
+        /// Originating node.
+        Node *node;
+        /// Payload.
+        EventId eventId;
+        /// Message type.
+        Defs::MTI mti;
+    };
+
+    /// Allocates a buffer for the next message.
+    Action send_next();
+    /// Fills in and sends the next message.
+    Action fill_message();
+    /// All messages are enqueued.
+    Action all_sent();
+
+    /// Collected messages.
+    std::unique_ptr<Entry[]> entries_;
+    /// Number of entries in entries_.
+    unsigned capacity_;
+    /// Number of messages collected.
+    unsigned count_ {0};
+    /// Index of the next message to send during a flush.
+    unsigned next_ {0};
+    /// Notified when the flush is complete.
+    Notifiable *done_ {nullptr};
+    /// Holds one child per message sent.
+    BarrierNotifiable bn_;
+};
+
 /// PImpl class for the EventService. This class creates and owns all
 /// components necessary to the correct operation of the EventService but does
 /// not need to appear on the application-facing API.
 class EventService::Impl
 {
 public:
-    Impl(EventService *service);
+    /// Constructor. @param service the parent. @param registry_type selects
+    /// the event registry implementation.
+    Impl(EventService *service, RegistryType registry_type);
     ~Impl();
 
     /// The implementation of the event registry.
@@ -132,9 +201,17 @@ public:
     ~EventIteratorFlow();
 
 protected:
+    /// The most messages an event handler may produce for one call; this is
+    /// the number of write helpers in the EventReport.
+    static constexpr unsigned MAX_MESSAGES_PER_HANDLER = 4;
+
     Action entry() OVERRIDE;
     Action iterate_next();
 
+    /// Calls an event handler directly on this flow's executor, instead of
+    /// going through the EventCallerFlow. @param entry the handler to call.
+    Action dispatch_inline(const EventRegistryEntry *entry);
+
 private:
     virtual Action dispatch_event(const EventRegistryEntry *entry);
 
@@ -158,6 +235,13 @@ protected:
     BarrierNotifiable n_;
     EventHandlerFunction fn_;
 
+    /// The handler we need to call.
+    const EventRegistryEntry *currentEntry_{nullptr};
+
+    /// Collects the identified messages for identify global. Allocated
+    /// upon the first identify message if batching is enabled.
+    std::unique_ptr<EventIdentifyBatch> identifyBatch_;
+
 #ifdef DEBUG_EVENT_PERFORMANCE
     static const int REPORT_COUNT = 100;
     /// How many events' cost are accumulated so far.
@@ -184,10 +268,10 @@ public:
     }
 
 private:
-    Action dispatch_event(const EventRegistryEntry *entry) OVERRIDE;
-
-    /// The handler we need to call.
-    const EventRegistryEntry *currentEntry_{nullptr};
+    Action dispatch_event(const EventRegistryEntry *entry) OVERRIDE
+    {
+        return dispatch_inline(entry);
+    }
 };
 
 } // namespace openlcb
@@ -34,11 +34,16 @@
 
 #include "openlcb/FilteringCanHubFlow.hxx"
 
+#include "nmranet_config.h"
+
 namespace openlcb
 {
 
 FilteringCanHubFlow::FilteringCanHubFlow(Service *service)
     : CanHubFlow(service)
+    , filter_(config_can_filter_flat_table() == CONSTANT_TRUE
+              ? CanFilter::TABLE_FLAT
+              : CanFilter::TABLE_MULTIMAP)
     , isFiltering_(true)
 {
 }
@@ -59,6 +59,20 @@ public:
 
     void unregister_port(CanHubFlow::port_type *port) override;
 
+    /// Shared ports are registered as regular ports, so that they are subject
+    /// to the filtering and can be made promiscuous. @param port is the port
+    /// to add.
+    void register_shared_port(CanHubFlow::shared_port_type *port) override
+    {
+        register_port(port);
+    }
+
+    /// @param port is the port to remove.
+    void unregister_shared_port(CanHubFlow::shared_port_type *port) override
+    {
+        unregister_port(port);
+    }
+
     /** Sets a port to be promiscuous.
      * @param port the port to set.
      * @param is_promiscuous true to enable promiscuous mode, false to disable.
@@ -187,6 +187,65 @@ If::If(ExecutorBase *executor, int local_nodes_count)
     , dispatcher_(this)
     , localNodes_(local_nodes_count)
 {
+    if (local_nodes_count > LOCAL_NODE_INDEX_THRESHOLD)
+    {
+        nodeHashBits_ = 4;
+        while ((1u << nodeHashBits_) < 2u * local_nodes_count)
+        {
+            ++nodeHashBits_;
+        }
+        nodeHash_.reset(new NodeSlot[1u << nodeHashBits_]());
+    }
+}
+
+void If::hash_insert(NodeID id, Node *node)
+{
+    if (2 * (nodeHashCount_ + 1) > (1u << nodeHashBits_))
+    {
+        // Keeps the load factor under 1/2 so that probe chains stay short.
+        std::unique_ptr<NodeSlot[]> old(std::move(nodeHash_));
+        unsigned old_size = 1u << nodeHashBits_;
+        ++nodeHashBits_;
+        nodeHash_.reset(new NodeSlot[1u << nodeHashBits_]());
+        for (unsigned i = 0; i < old_size; ++i)
+        {
+            if (old[i].node)
+            {
+                nodeHash_[node_slot(old[i].id)] = old[i];
+            }
+        }
+    }
+    unsigned slot = node_slot(id);
+    HASSERT(!nodeHash_[slot].node);
+    nodeHash_[slot].id = id;
+    nodeHash_[slot].node = node;
+    ++nodeHashCount_;
+}
+
+void If::hash_erase(NodeID id)
+{
+    unsigned mask = (1u << nodeHashBits_) - 1;
+    unsigned slot = node_slot(id);
+    HASSERT(nodeHash_[slot].node);
+    unsigned j = slot;
+    while (true)
+    {
+        j = (j + 1) & mask;
+        if (!nodeHash_[j].node)
+        {
+            break;
+        }
+        unsigned home = node_home(nodeHash_[j].id);
+        // The entry at j can fill the hole at slot only if its home position
+        // is not cyclically within (slot, j].
+        if (((j - home) & mask) >= ((j - slot) & mask))
+        {
+            nodeHash_[slot] = nodeHash_[j];
+            slot = j;
+        }
+    }
+    nodeHash_[slot].node = nullptr;
+    --nodeHashCount_;
 }
 
 } // namespace openlcb
@@ -36,6 +36,7 @@
 #define _OPENLCB_IF_HXX_
 
 /// @todo(balazs.racz) remove this dep
+#include <memory>
 #include <string>
 
 #include "executor/Dispatcher.hxx"
@@ -244,6 +245,10 @@ public:
         NodeID id = node->node_id();
         HASSERT(localNodes_.find(id) == localNodes_.end());
         localNodes_[id] = node;
+        if (nodeHash_)
+        {
+            hash_insert(id, node);
+        }
     }
 
     /** Removes a local node from this interface. This function must be called
@@ -262,6 +267,10 @@ public:
      */
     Node *lookup_local_node(NodeID id)
     {
+        if (nodeHash_)
+        {
+            return nodeHash_[node_slot(id)].node;
+        }
         auto it = localNodes_.find(id);
         if (it == localNodes_.end())
         {
@@ -358,11 +367,19 @@ public:
     }
 
 protected:
+    /// Interfaces that are sized for more virtual nodes than this get the
+    /// hashed local node index (and on CAN, the direct alias table).
+    static constexpr int LOCAL_NODE_INDEX_THRESHOLD = 64;
+
     void remove_local_node_from_map(Node *node)
     {
         auto it = localNodes_.find(node->node_id());
         HASSERT(it != localNodes_.end());
         localNodes_.erase(it);
+        if (nodeHash_)
+        {
+            hash_erase(node->node_id());
+        }
     }
 
     /// Allocator containing the global write flows.
@@ -382,6 +399,53 @@ private:
     /// Local virtual nodes registered on this interface.
     VNodeMap localNodes_;
 
+    /// One slot of the hashed local node index.
+    struct NodeSlot
+    {
+        /// Node ID of the entry, undefined if node is null.
+        NodeID id;
+        /// Registered node, or nullptr if the slot is empty.
+        Node *node;
+    };
+
+    /// @return the preferred slot of a node ID in nodeHash_.
+    /// @param id Node ID
+    unsigned node_home(NodeID id)
+    {
+        // Fibonacci hashing on the folded 48-bit ID.
+        uint32_t key = (uint32_t)id ^ ((uint32_t)(id >> 32) * 0x85EBCA6Bu);
+        return (key * 0x9E3779B1u) >> (32 - nodeHashBits_);
+    }
+
+    /// @return the slot in nodeHash_ that contains the given node ID, or the
+    /// empty slot where it would be inserted.
+    /// @param id Node ID to look for
+    unsigned node_slot(NodeID id)
+    {
+        unsigned mask = (1u << nodeHashBits_) - 1;
+        unsigned i = node_home(id);
+        while (nodeHash_[i].node && nodeHash_[i].id != id)
+        {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    /// Adds an entry to nodeHash_, growing the table if it gets too full.
+    void hash_insert(NodeID id, Node *node);
+
+    /// Removes an entry from nodeHash_ using backward-shift deletion.
+    void hash_erase(NodeID id);
+
+    /// Open-addressed (linear probing) index of localNodes_ by node ID. Null
+    /// for small interfaces, which only use the ordered map. The ordered map
+    /// is kept in both cases because iteration is in node ID order.
+    std::unique_ptr<NodeSlot[]> nodeHash_;
+    /// log2 of the number of slots in nodeHash_.
+    unsigned nodeHashBits_ {0};
+    /// Number of used slots in nodeHash_.
+    unsigned nodeHashCount_ {0};
+
     /// Accessor for the objects and variables for supporting stream transport.
     StreamTransport *streamTransport_ {nullptr};
 
@@ -34,12 +34,15 @@
 
 #include "openlcb/IfCan.hxx"
 
+#include <algorithm>
+
 #include "utils/StlMap.hxx"
 #include "openlcb/AliasAllocator.hxx"
 #include "openlcb/IfImpl.hxx"
 #include "openlcb/IfCanImpl.hxx"
 #include "openlcb/CanDefs.hxx"
 #include "can_frame.h"
+#include "nmranet_config.h"
 
 namespace openlcb
 {
@@ -190,6 +193,7 @@ public:
             alias_ ? if_can()->local_aliases()->lookup(NodeAlias(alias_)) : 0;
         // Actually purge the table entry.
         if_can()->local_aliases()->remove(alias_);
+        if_can()->forget_local_node_alias(alias_);
         if (!node || CanDefs::is_reserved_alias_node_id(node))
         {
             // We do not have a node ID to use for alias release.
@@ -608,7 +612,10 @@ public:
         }
         // Gets the destination address and checks if it is our node.
         dstHandle_.alias = (((unsigned)f->data[0] & 0xf) << 8) | f->data[1];
-        dstHandle_.id = if_can()->local_aliases()->lookup(dstHandle_.alias);
+        Node *dst_node = if_can()->lookup_local_node_alias(dstHandle_.alias);
+        dstHandle_.id = dst_node
+            ? dst_node->node_id()
+            : if_can()->local_aliases()->lookup(dstHandle_.alias);
         if (!dstHandle_.id) // Not destined for us.
         {
             LOG(VERBOSE, "Dropping addressed message not for local destination."
@@ -710,9 +717,24 @@ IfCan::IfCan(ExecutorBase *executor, CanHubFlow *device,
     int local_nodes_count)
     : If(executor, local_nodes_count)
     , CanIf(this, device)
-    , localAliases_(0, local_alias_cache_size)
-    , remoteAliases_(0, remote_alias_cache_size)
+    , localAliases_(0, local_alias_cache_size, &IfCan::local_alias_evicted,
+          this,
+          local_nodes_count > LOCAL_NODE_INDEX_THRESHOLD
+              ? AliasCache::INDEX_HASH
+              : AliasCache::INDEX_SORTED)
+    // Large remote caches (gateways) see a lot of alias churn; the hash
+    // index makes that constant time at a few extra bytes per entry.
+    , remoteAliases_(0, remote_alias_cache_size, nullptr, nullptr,
+          remote_alias_cache_size > 64 ? AliasCache::INDEX_HASH
+                                       : AliasCache::INDEX_SORTED)
 {
+    if (local_nodes_count > LOCAL_NODE_INDEX_THRESHOLD)
+    {
+        // Command stations with hundreds of train nodes resolve the
+        // destination of every addressed message; this makes that a single
+        // array access.
+        aliasNodes_.reset(new Node *[1u << 12]());
+    }
     auto *gflow = new GlobalCanMessageWriteFlow(this);
     globalWriteFlow_ = gflow;
     add_owned_flow(gflow);
@@ -785,13 +807,21 @@ void IfCan::add_addressed_message_support()
     if (addressedWriteFlow_)
         return;
     add_owned_flow(new FrameToAddressedMessageParser(this));
-    auto *f = new AddressedCanMessageWriteFlow(this);
+    auto *f = new AddressedCanMessageWriteFlow(
+        this, config_remote_alias_parallel_lookups());
     addressedWriteFlow_ = f;
     add_owned_flow(f);
 }
 
 void IfCan::delete_local_node(Node *node) {
     remove_local_node_from_map(node);
+    if (aliasNodes_)
+    {
+        // The table may hold the node under an alias that the cache does not
+        // know anymore (e.g. after a stack restart).
+        std::replace(&aliasNodes_[0], &aliasNodes_[1u << 12], node,
+            static_cast<Node *>(nullptr));
+    }
     auto alias = localAliases_.lookup(node->node_id());
     if (alias) {
         // The node had a local alias.
@@ -847,11 +877,39 @@ Node *IfCan::lookup_local_node_handle(NodeHandle h)
 {
     if (!h.id)
     {
-        h.id = local_aliases()->lookup(h.alias);
+        return h.alias ? lookup_local_node_alias(h.alias) : nullptr;
     }
     return lookup_local_node(h.id);
 }
 
+Node *IfCan::lookup_local_node_alias(NodeAlias alias)
+{
+    NodeID id = local_aliases()->lookup(alias);
+    Node **entry = aliasNodes_ ? &aliasNodes_[alias & 0xFFF] : nullptr;
+    if (!id)
+    {
+        if (entry)
+        {
+            *entry = nullptr;
+        }
+        return nullptr;
+    }
+    // The alias cache can be cleared or edited behind our back (e.g. on a
+    // stack restart), so the table entry is only used if it still belongs to
+    // the node that owns the alias now. Deleted nodes are always removed from
+    // the table, so the entry can be dereferenced.
+    if (entry && *entry && (*entry)->node_id() == id)
+    {
+        return *entry;
+    }
+    Node *n = lookup_local_node(id);
+    if (entry)
+    {
+        *entry = n;
+    }
+    return n;
+}
+
 NodeID IfCan::get_default_node_id()
 {
     if (!aliasAllocator_)
@@ -132,6 +132,27 @@ public:
 
     Node *lookup_local_node_handle(NodeHandle handle) override;
 
+    /** Looks up a local node by its alias. This function must be called from
+     * the interface's executor.
+     *
+     * @param alias is the 12-bit alias to look up.
+     * @returns the node pointer or nullptr if the alias does not belong to a
+     * registered local node. */
+    Node *lookup_local_node_alias(NodeAlias alias);
+
+    /** Drops the alias from the direct alias-to-node table. Must be called
+     * whenever a local node's alias is released or lost to a conflict.
+     *
+     * @param alias is the 12-bit alias that is not owned by the node anymore.
+     */
+    void forget_local_node_alias(NodeAlias alias)
+    {
+        if (aliasNodes_ && alias <= 0xFFF)
+        {
+            aliasNodes_[alias] = nullptr;
+        }
+    }
+
     NodeID get_default_node_id() override;
 
 private:
@@ -150,6 +171,22 @@ private:
      */
     AliasCache remoteAliases_;
 
+    /// Called by localAliases_ when add() replaces or evicts an entry.
+    static void local_alias_evicted(NodeID, NodeAlias alias, void *ctx)
+    {
+        static_cast<IfCan *>(ctx)->forget_local_node_alias(alias);
+    }
+
+    /** Direct table from alias to local node, filled in on the first lookup
+     * of each alias and cleared whenever localAliases_ drops the alias. An
+     * entry is only used if its node still owns the alias in localAliases_.
+     * Null for small interfaces, where the alias cache and the node map are
+     * used instead. 4096 entries, one for each alias.
+     *
+     *  This member must only be accessed from the If's executor.
+     */
+    std::unique_ptr<Node *[]> aliasNodes_;
+
     /// Various implementation control flows that this interface owns.
     std::vector<std::unique_ptr<Executable>> ownedFlows_;
 
@@ -35,6 +35,9 @@
 #ifndef _OPENLCB_IFCANIMPL_HXX_
 #define _OPENLCB_IFCANIMPL_HXX_
 
+#include <memory>
+#include <vector>
+
 #include "openlcb/CanDefs.hxx"
 #include "executor/StateFlow.hxx"
 #include "openlcb/IfImpl.hxx"
@@ -221,16 +224,384 @@ private:
     }
 };
 
+/** This helper class listens for incoming CAN frames looking for the alias
+ * mapping definition of a given remote node. */
+class AliasDefListener : public IncomingFrameHandler
+{
+public:
+    /// Constructor.
+    /// @param if_can the interface to listen on.
+    /// @param timer will be triggered when the alias is found.
+    AliasDefListener(IfCan *if_can, ::Timer *timer)
+        : ifCan_(if_can)
+        , timer_(timer)
+    {
+    }
+
+    enum
+    {
+        // AMD frames
+        CAN_FILTER1 = CanMessageData::CAN_EXT_FRAME_FILTER | 0x10701000,
+        CAN_MASK1 = CanMessageData::CAN_EXT_FRAME_MASK | 0x1FFFF000,
+        // Initialization complete
+        CAN_FILTER2 = CanMessageData::CAN_EXT_FRAME_FILTER | 0x19100000,
+        CAN_MASK2 = CanMessageData::CAN_EXT_FRAME_MASK | 0x1FFFF000,
+        // Verified node ID number
+        CAN_FILTER3 = CanMessageData::CAN_EXT_FRAME_FILTER | 0x19170000,
+        CAN_MASK3 = CanMessageData::CAN_EXT_FRAME_MASK | 0x1FFFF000,
+    };
+
+    /// Starts listening for the alias of a node.
+    /// @param id the node ID to look for.
+    void start(NodeID id)
+    {
+        nodeId_ = id;
+        alias_ = 0;
+        RegisterLocalHandler();
+    }
+
+    /// @return the alias found, or zero if no alias definition came yet.
+    NodeAlias alias()
+    {
+        return alias_;
+    }
+
+    // Registers *this to the ifcan to receive alias resolution messages.
+    void RegisterLocalHandler()
+    {
+        ifCan_->frame_dispatcher()->register_handler(
+            this, CAN_FILTER1, CAN_MASK1);
+        ifCan_->frame_dispatcher()->register_handler(
+            this, CAN_FILTER2, CAN_MASK2);
+        ifCan_->frame_dispatcher()->register_handler(
+            this, CAN_FILTER3, CAN_MASK3);
+    }
+
+    // Unregisters *this from the ifcan to not receive alias resolution
+    // messages.
+    void UnregisterLocalHandler()
+    {
+        ifCan_->frame_dispatcher()->unregister_handler(
+            this, CAN_FILTER1, CAN_MASK1);
+        ifCan_->frame_dispatcher()->unregister_handler(
+            this, CAN_FILTER2, CAN_MASK2);
+        ifCan_->frame_dispatcher()->unregister_handler(
+            this, CAN_FILTER3, CAN_MASK3);
+    }
+
+    /// Handler callback for incoming messages.
+    void send(Buffer<CanMessageData> *message, unsigned priority) OVERRIDE
+    {
+        struct can_frame *f = message->data();
+        uint32_t id = GET_CAN_FRAME_ID_EFF(*f);
+        if (f->can_dlc != 6)
+        {
+            // Not sending a node ID.
+            message->unref();
+            return;
+        }
+        uint64_t nodeid_be = htobe64(nodeId_);
+        uint8_t *nodeid_start = reinterpret_cast<uint8_t *>(&nodeid_be) + 2;
+        if (memcmp(nodeid_start, f->data, 6))
+        {
+            // Node id does not match.
+            message->unref();
+            return;
+        }
+        // Now: we have an alias.
+        alias_ = id & CanDefs::SRC_MASK;
+        if (!alias_)
+        {
+            LOG_ERROR("Incoming alias definition message with zero alias. "
+                      "CAN frame id %08x",
+                (unsigned)id);
+            message->unref();
+            return;
+        }
+        UnregisterLocalHandler();
+        ifCan_->remote_aliases()->add(nodeId_, alias_);
+        timer_->trigger();
+        message->unref();
+    }
+
+private:
+    /// Interface we are listening on.
+    IfCan *ifCan_;
+    /// Woken up when the alias is found.
+    ::Timer *timer_;
+    /// Node ID we are looking for.
+    NodeID nodeId_ {0};
+    /// Alias found for nodeId_, or zero.
+    NodeAlias alias_ {0};
+};
+
+/** Looks up the aliases of remote nodes on behalf of an addressed write flow.
+ *
+ * Messages to a destination whose alias is being looked up are parked here,
+ * so that the write flow can continue with messages to other nodes. Several
+ * lookups run in parallel. Once the alias is found, the parked messages are
+ * sent back to the write flow in the original order, ahead of the other
+ * queued messages. If the node does not respond, the parked messages are
+ * dropped. */
+class RemoteAliasResolver
+{
+public:
+    /// Constructor.
+    /// @param if_can the interface to perform lookups on.
+    /// @param flow where to send the messages after their destination alias
+    /// is known.
+    /// @param num_lookups how many lookups may run in parallel.
+    RemoteAliasResolver(IfCan *if_can,
+        FlowInterface<Buffer<GenMessage>> *flow, unsigned num_lookups)
+        : ifCan_(if_can)
+        , flow_(flow)
+    {
+        for (unsigned i = 0; i < num_lookups; ++i)
+        {
+            lookups_.emplace_back(new LookupFlow(this));
+        }
+    }
+
+    /// @param id a destination node ID.
+    /// @return true if messages to this node are parked.
+    bool is_pending(NodeID id)
+    {
+        for (auto &l : lookups_)
+        {
+            if (l->dst_ == id)
+            {
+                return true;
+            }
+        }
+        for (auto *b : waiting_)
+        {
+            if (b->data()->dst.id == id)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Parks a message until the alias of its destination is found. Starts
+    /// the lookup if there is none running for this destination.
+    /// @param b the message; ownership is transferred.
+    void park(Buffer<GenMessage> *b)
+    {
+        NodeID id = b->data()->dst.id;
+        HASSERT(id);
+        for (auto &l : lookups_)
+        {
+            if (l->dst_ == id)
+            {
+                l->parked_.insert(b);
+                return;
+            }
+        }
+        for (auto &l : lookups_)
+        {
+            if (!l->dst_)
+            {
+                l->parked_.insert(b);
+                l->start(b->data());
+                return;
+            }
+        }
+        // All lookups are busy.
+        waiting_.push_back(b);
+    }
+
+private:
+    /// State flow performing the lookup of one destination node.
+    class LookupFlow : public StateFlowBase
+    {
+    public:
+        LookupFlow(RemoteAliasResolver *parent)
+            : StateFlowBase(parent->ifCan_)
+            , parent_(parent)
+            , timer_(this)
+        {
+        }
+
+    private:
+        friend class RemoteAliasResolver;
+
+        IfCan *if_can()
+        {
+            return parent_->ifCan_;
+        }
+
+        /// Starts the lookup for the destination of a message.
+        /// @param msg the first message parked for this destination.
+        void start(GenMessage *msg)
+        {
+            dst_ = msg->dst.id;
+            src_ = msg->src.id;
+            start_flow(STATE(find_remote_alias));
+        }
+
+        Action find_remote_alias()
+        {
+            listener_.start(dst_);
+            srcAlias_ = if_can()->local_aliases()->lookup(src_);
+            if (srcAlias_)
+            {
+                // We can try to send an AME (alias mapping enquiry) frame.
+                return allocate_and_call(
+                    if_can()->frame_write_flow(), STATE(send_ame_frame));
+            }
+            // No local alias -- we need to jump straight to local nodeid
+            // verify. That will allocate a new local alias.
+            return call_immediately(STATE(send_verify_nodeid_global));
+        }
+
+        Action send_ame_frame()
+        {
+            auto *b = get_allocation_result(if_can()->frame_write_flow());
+            struct can_frame *f = b->data();
+            CanDefs::control_init(*f, srcAlias_, CanDefs::AME_FRAME, 0);
+            f->can_dlc = 6;
+            uint64_t rd = htobe64(dst_);
+            memcpy(f->data, reinterpret_cast<uint8_t *>(&rd) + 2, 6);
+            if_can()->frame_write_flow()->send(b);
+            return sleep_and_call(&timer_,
+                ADDRESSED_MESSAGE_LOOKUP_TIMEOUT_NSEC,
+                STATE(send_verify_nodeid_global));
+        }
+
+        Action send_verify_nodeid_global()
+        {
+            if (listener_.alias())
+            {
+                return call_immediately(STATE(lookup_done));
+            }
+            return allocate_and_call(if_can()->global_message_write_flow(),
+                STATE(fill_verify_nodeid_global));
+        }
+
+        Action fill_verify_nodeid_global()
+        {
+            auto *b =
+                get_allocation_result(if_can()->global_message_write_flow());
+            b->data()->reset(Defs::MTI_VERIFY_NODE_ID_GLOBAL, src_,
+                node_id_to_buffer(dst_));
+            if_can()->global_message_write_flow()->send(b);
+            return sleep_and_call(&timer_,
+                ADDRESSED_MESSAGE_LOOKUP_TIMEOUT_NSEC, STATE(lookup_done));
+        }
+
+        Action lookup_done()
+        {
+            bool found = listener_.alias() != 0;
+            if (!found)
+            {
+                LOG(INFO, "AddressedWriteFlow: Could not resolve destination "
+                          "address %012" PRIx64
+                          " to an alias on the bus. Dropping %u packet(s).",
+                    dst_, (unsigned)parked_.pending());
+                listener_.UnregisterLocalHandler();
+                if_can()->remote_aliases()->add(dst_, NOT_RESPONDING);
+            }
+            dst_ = 0;
+            while (!parked_.empty())
+            {
+                auto *b =
+                    static_cast<Buffer<GenMessage> *>(parked_.next().item);
+                if (found)
+                {
+                    // Highest priority, so that these messages are not
+                    // overtaken by later messages to the same node.
+                    parent_->flow_->send(b, 0);
+                }
+                else
+                {
+                    /// @todo: generate a terminate due to error response
+                    /// message.
+                    b->unref();
+                }
+            }
+            if (parent_->take_waiting(this))
+            {
+                return call_immediately(STATE(find_remote_alias));
+            }
+            return exit();
+        }
+
+        /// Owning resolver.
+        RemoteAliasResolver *parent_;
+        /// Node ID being looked up, zero if this lookup is idle.
+        NodeID dst_ {0};
+        /// Local node that sent the first message to dst_.
+        NodeID src_;
+        /// Messages waiting for the alias of dst_.
+        Q parked_;
+        /// Local alias to send the AME frame from.
+        NodeAlias srcAlias_;
+        /// Lookup timeout.
+        StateFlowTimer timer_;
+        /// Catches the alias definition of dst_.
+        AliasDefListener listener_ {parent_->ifCan_, &timer_};
+    };
+
+    /// Moves the messages of the oldest waiting destination to an idle
+    /// lookup.
+    /// @param l the idle lookup.
+    /// @return true if there was a waiting message.
+    bool take_waiting(LookupFlow *l)
+    {
+        if (waiting_.empty())
+        {
+            return false;
+        }
+        l->dst_ = waiting_.front()->data()->dst.id;
+        l->src_ = waiting_.front()->data()->src.id;
+        auto it = waiting_.begin();
+        while (it != waiting_.end())
+        {
+            if ((*it)->data()->dst.id == l->dst_)
+            {
+                l->parked_.insert(*it);
+                it = waiting_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        return true;
+    }
+
+    /// Interface we are performing lookups on.
+    IfCan *ifCan_;
+    /// Write flow to return the messages to.
+    FlowInterface<Buffer<GenMessage>> *flow_;
+    /// Lookups, each of them either idle or working on one destination.
+    std::vector<std::unique_ptr<LookupFlow>> lookups_;
+    /// Messages for which no lookup was free, in arrival order.
+    std::vector<Buffer<GenMessage> *> waiting_;
+};
+
 /** The addressed write flow is responsible for sending addressed messages to
  * the CANbus. It uses some shared states from the generic CAN write flow base
  * class, and extends it with destination alias lookup states.  */
 class AddressedCanMessageWriteFlow : public CanMessageWriteFlow
 {
 public:
-    AddressedCanMessageWriteFlow(IfCan *if_can)
+    /// Constructor.
+    /// @param if_can the interface to send messages to.
+    /// @param parallel_lookups if nonzero, messages to nodes with unknown
+    /// alias are handed over to a resolver which runs this many lookups in
+    /// parallel, and this flow continues with the next message. If zero, the
+    /// flow performs the lookup itself and waits for it to complete.
+    AddressedCanMessageWriteFlow(IfCan *if_can, unsigned parallel_lookups = 0)
         : CanMessageWriteFlow(if_can)
         , timer_(this)
     {
+        if (parallel_lookups)
+        {
+            resolver_.reset(
+                new RemoteAliasResolver(if_can, this, parallel_lookups));
+        }
     }
 
 protected:
@@ -258,6 +629,12 @@ protected:
         HASSERT(dst_.id || dst_.alias); // We must have some kind of address.
         if (dst_.id)
         {
+            if (resolver_ && resolver_->is_pending(dst_.id))
+            {
+                // Keeps the order of messages to the same destination.
+                resolver_->park(transfer_message());
+                return exit();
+            }
             dstAlias_ = if_can()->remote_aliases()->lookup(dst_.id);
             if (dstAlias_ == NOT_RESPONDING)
             {
@@ -271,16 +648,12 @@ protected:
         else if (dst_.alias)
         {
             // Check if this is a local node being called by alias.
-            NodeID id = if_can()->local_aliases()->lookup(dst_.alias);
-            if (id)
+            Node *dst_node = if_can()->lookup_local_node_alias(dst_.alias);
+            if (dst_node)
             {
-                Node *dst_node = if_can()->lookup_local_node(id);
-                if (dst_node)
-                {
-                    dst_.id = id;
-                    nmsg()->dstNode = dst_node;
-                    return call_immediately(STATE(send_to_local_node));
-                }
+                dst_.id = dst_node->node_id();
+                nmsg()->dstNode = dst_node;
+                return call_immediately(STATE(send_to_local_node));
             }
         }
         if (dst_.alias && dstAlias_ && dst_.alias != dstAlias_)
@@ -308,7 +681,13 @@ protected:
 
     Action find_remote_alias()
     {
-        aliasListener_.RegisterLocalHandler();
+        if (resolver_)
+        {
+            // Lets the next message go while the lookup is running.
+            resolver_->park(transfer_message());
+            return exit();
+        }
+        aliasListener_.start(nmsg()->dst.id);
         srcAlias_ =
             if_can()->local_aliases()->lookup(nmsg()->src.id);
         if (srcAlias_)
@@ -340,6 +719,7 @@ protected:
 
     Action send_verify_nodeid_global()
     {
+        dstAlias_ = aliasListener_.alias();
         if (dstAlias_)
         {
             return call_immediately(STATE(remote_alias_found));
@@ -361,7 +741,8 @@ protected:
 
     Action wait_looking_for_dst()
     {
-        if (dstAlias_ && dstAlias_ <= 0xFFF)
+        dstAlias_ = aliasListener_.alias();
+        if (dstAlias_)
         {
             return call_immediately(STATE(remote_alias_found));
         }
@@ -385,94 +766,11 @@ protected:
         return call_immediately(STATE(find_local_alias));
     }
 
-    /** This helper class listend for incoming CAN frames looking for alias
-     * mapping definitions. */
-    class AliasDefListener : public IncomingFrameHandler
-    {
-    public:
-        AliasDefListener(AddressedCanMessageWriteFlow* parent)
-            : parent_(parent) {}
-
-        enum
-        {
-            // AMD frames
-            CAN_FILTER1 = CanMessageData::CAN_EXT_FRAME_FILTER | 0x10701000,
-            CAN_MASK1 = CanMessageData::CAN_EXT_FRAME_MASK | 0x1FFFF000,
-            // Initialization complete
-            CAN_FILTER2 = CanMessageData::CAN_EXT_FRAME_FILTER | 0x19100000,
-            CAN_MASK2 = CanMessageData::CAN_EXT_FRAME_MASK | 0x1FFFF000,
-            // Verified node ID number
-            CAN_FILTER3 = CanMessageData::CAN_EXT_FRAME_FILTER | 0x19170000,
-            CAN_MASK3 = CanMessageData::CAN_EXT_FRAME_MASK | 0x1FFFF000,
-        };
-
-        IfCan* if_can() { return parent_->if_can(); }
-
-        // Registers *this to the ifcan to receive alias resolution messages.
-        void RegisterLocalHandler()
-        {
-            if_can()->frame_dispatcher()->register_handler(
-                this, CAN_FILTER1, CAN_MASK1);
-            if_can()->frame_dispatcher()->register_handler(
-                this, CAN_FILTER2, CAN_MASK2);
-            if_can()->frame_dispatcher()->register_handler(
-                this, CAN_FILTER3, CAN_MASK3);
-        }
-
-        // Unregisters *this from the ifcan to not receive alias resolution
-        // messages.
-        void UnregisterLocalHandler()
-        {
-            if_can()->frame_dispatcher()->unregister_handler(
-                this, CAN_FILTER1, CAN_MASK1);
-            if_can()->frame_dispatcher()->unregister_handler(
-                this, CAN_FILTER2, CAN_MASK2);
-            if_can()->frame_dispatcher()->unregister_handler(
-                this, CAN_FILTER3, CAN_MASK3);
-        }
-
-        /// Handler callback for incoming messages.
-        void send(Buffer<CanMessageData> *message, unsigned priority) OVERRIDE
-        {
-            struct can_frame *f = message->data();
-            uint32_t id = GET_CAN_FRAME_ID_EFF(*f);
-            if (f->can_dlc != 6)
-            {
-                // Not sending a node ID.
-                message->unref();
-                return;
-            }
-            uint64_t nodeid_be = htobe64(parent_->nmsg()->dst.id);
-            uint8_t *nodeid_start = reinterpret_cast<uint8_t *>(&nodeid_be) + 2;
-            if (memcmp(nodeid_start, f->data, 6))
-            {
-                // Node id does not match.
-                message->unref();
-                return;
-            }
-            // Now: we have an alias.
-            parent_->dstAlias_ = id & CanDefs::SRC_MASK;
-            if (!parent_->dstAlias_)
-            {
-                LOG_ERROR("Incoming alias definition message with zero alias. "
-                           "CAN frame id %08x",
-                    (unsigned)id);
-                message->unref();
-                return;
-            }
-            UnregisterLocalHandler();
-            if_can()->remote_aliases()->add(parent_->nmsg()->dst.id, parent_->dstAlias_);
-            parent_->timer_.trigger();
-            message->unref();
-        }
-
-    private:
-        AddressedCanMessageWriteFlow* parent_;
-    } aliasListener_{this};
-
-    friend class AliasDefListener;
-
     StateFlowTimer timer_;
+    /// Catches the alias definition of the destination node.
+    AliasDefListener aliasListener_{if_can(), &timer_};
+    /// Performs the destination alias lookups when not null.
+    std::unique_ptr<RemoteAliasResolver> resolver_;
 };
 } // namespace openlcb
 
@@ -180,6 +180,14 @@ size_t FileMemorySpace::write(address_t destination, const uint8_t *data,
 
 size_t FileMemorySpace::read(address_t destination, uint8_t *dst, size_t len,
                              errorcode_t *error, Notifiable *again)
+{
+    ReadSegment seg {dst, len};
+    return read_vector(destination, &seg, 1, error, again);
+}
+
+size_t FileMemorySpace::read_vector(address_t destination,
+    const ReadSegment *segments, unsigned count, errorcode_t *error,
+    Notifiable *again)
 {
     ensure_file_open();
     if (fd_ < 0)
@@ -198,35 +206,42 @@ size_t FileMemorySpace::read(address_t destination, uint8_t *dst, size_t len,
         *error = MemoryConfigDefs::ERROR_OUT_OF_BOUNDS;
         return 0;
     }
-    if (destination + len > fileSize_)
-    {
-        len = fileSize_ - destination;
-    }
-    ssize_t ret = ::read(fd_, dst, len);
-    if (ret < 0)
-    {
-        LOG(INFO, "Error reading from fd %d: %s", fd_, strerror(errno));
-        *error = Defs::ERROR_PERMANENT;
-        return 0;
-    }
-    else if (ret == 0)
-    {
-        // EOF
-        *error = MemoryConfigDefs::ERROR_OUT_OF_BOUNDS;
-        return 0;
-    }
-    else if ((size_t)ret < len)
+    size_t avail = fileSize_ - destination;
+    size_t total = 0;
+    for (unsigned i = 0; i < count && total < avail; ++i)
     {
+        size_t len = segments[i].len;
+        if (len > avail - total)
+        {
+            len = avail - total;
+        }
+        ssize_t ret = ::read(fd_, segments[i].dst, len);
+        if (ret < 0)
+        {
+            LOG(INFO, "Error reading from fd %d: %s", fd_, strerror(errno));
+            *error = Defs::ERROR_PERMANENT;
+            return total;
+        }
+        else if (ret == 0)
+        {
+            // EOF
+            if (!total)
+            {
+                *error = MemoryConfigDefs::ERROR_OUT_OF_BOUNDS;
+            }
+            return total;
+        }
+        total += ret;
+        if ((size_t)ret < len)
+        {
 #ifdef __FreeRTOS__
-        *error = ERROR_AGAIN;
-        HASSERT(ioctl(fd_, CAN_IOC_READ_ACTIVE, again) == 0);
+            *error = ERROR_AGAIN;
+            HASSERT(ioctl(fd_, CAN_IOC_READ_ACTIVE, again) == 0);
 #endif
-        return ret;
-    }
-    else
-    {
-        return ret;
+            return total;
+        }
     }
+    return total;
 }
 
 } // namespace openlcb
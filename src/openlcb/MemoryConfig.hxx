@@ -67,6 +67,15 @@ public:
     typedef uint32_t address_t;
     typedef uint16_t errorcode_t;
 
+    /// One destination buffer of a read_vector call.
+    struct ReadSegment
+    {
+        /// Where to put the data.
+        uint8_t *dst;
+        /// How many bytes to put there.
+        size_t len;
+    };
+
     /** This error code signals that the operation was only partially
      * completed, the again notify was used and will be notified when the
      * operation can be re-tried). */
@@ -159,6 +168,43 @@ public:
     virtual size_t read(address_t source, uint8_t *dst, size_t len,
                         errorcode_t *error, Notifiable *again) = 0;
 
+    /// Reads a contiguous range of the address space into a sequence of
+    /// destination buffers (scatter-gather). The bytes fill the segments in
+    /// order; a short read fills a prefix of them. The arguments and return
+    /// value are the same as for read(), with the length being the sum of the
+    /// segment lengths. The default implementation calls read() for each
+    /// segment; spaces that can serve large regions in one operation should
+    /// override it.
+    /// @param source memory space offset address to read from
+    /// @param segments array of destination buffers
+    /// @param count number of entries in segments
+    /// @param error output argument for the error code, see read().
+    /// @param again notified when an ERROR_AGAIN operation can continue.
+    /// @return the total number of bytes read.
+    virtual size_t read_vector(address_t source, const ReadSegment *segments,
+        unsigned count, errorcode_t *error, Notifiable *again)
+    {
+        size_t total = 0;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            // read() only writes the error code when it fails.
+            errorcode_t err = 0;
+            size_t ret = read(
+                source + total, segments[i].dst, segments[i].len, &err, again);
+            total += ret;
+            if (err)
+            {
+                *error = err;
+                break;
+            }
+            if (ret < segments[i].len)
+            {
+                break;
+            }
+        }
+        return total;
+    }
+
     /** Handles space freeze command. Returns an error code, or 0 for
      * success. */
     virtual errorcode_t freeze() {
@@ -329,6 +375,9 @@ public:
     size_t read(address_t source, uint8_t *dst, size_t len, errorcode_t *error,
                 Notifiable *again) OVERRIDE;
 
+    size_t read_vector(address_t source, const ReadSegment *segments,
+        unsigned count, errorcode_t *error, Notifiable *again) override;
+
 private:
     /** Makes fd a valid parameter, and ensures fileSize is filled in. */
     void ensure_file_open();
@@ -851,7 +851,8 @@ public:
         HASSERT(iface);
         HASSERT(iface->stream_transport());
         dstStreamId_ = iface->stream_transport()->get_next_stream_receive_id();
-        receiver_.reset(new StreamReceiverCan(iface, dstStreamId_));
+        receiver_.reset(new StreamReceiverCan(
+            iface, dstStreamId_, StreamReceiverCan::WINDOW_ADAPTIVE));
     }
 
 protected:
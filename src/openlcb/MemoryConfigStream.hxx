@@ -39,11 +39,17 @@
 #include "openlcb/MemoryConfig.hxx"
 #include "openlcb/StreamSender.hxx"
 #include "openlcb/StreamTransport.hxx"
+#include "nmranet_config.h"
 
 namespace openlcb
 {
 
 /// This is a self-owned flow which reads an memory space into a stream.
+///
+/// The data is read in blocks of one or more raw buffers using
+/// MemorySpace::read_vector. The buffer pool holds two blocks, so the next
+/// block is read from the memory space while the stream sender is still
+/// rendering the previous one into CAN frames.
 class MemorySpaceStreamReadFlow : public StateFlowBase
 {
 public:
@@ -73,6 +79,8 @@ public:
         , node_(node)
         , ofs_(ofs)
         , len_(len)
+        , blockBuffers_(block_buffers())
+        , sendBufferPool_(sizeof(RawBuffer), 2 * blockBuffers_, rawBufferPool)
     {
         LOG(INFO, "starting streamed read, dst %02x", dstStreamId_);
         start_flow(STATE(alloc_stream));
@@ -148,8 +156,14 @@ private:
         LOG(INFO, "have raw buf len %u", (unsigned)len_);
 
         RawBufferPtr raw_buffer(get_allocation_result<RawData>(nullptr));
-        sendBuffer_ = get_buffer_deleter(sender_->alloc());
-        sendBuffer_->data()->set_from(std::move(raw_buffer), 0);
+        auto &b = block_[blockCount_++];
+        b = get_buffer_deleter(sender_->alloc());
+        b->data()->set_from(std::move(raw_buffer), 0);
+        if (blockCount_ < blockBuffers_ &&
+            len_ > blockCount_ * RawData::MAX_SIZE)
+        {
+            return call_immediately(STATE(alloc_buffer));
+        }
         return call_immediately(STATE(try_read));
     }
 
@@ -157,36 +171,56 @@ private:
     {
         if (!len_)
         {
-            sender_->send(sendBuffer_.release());
-            senderCan_->close_stream();
-            return call_immediately(STATE(wait_for_close));
+            return call_immediately(STATE(send_last_block));
         }
-        size_t free = sendBuffer_->data()->free_space();
-        if (!free)
+        // Collects the free space of the block, limited by the requested
+        // length.
+        MemorySpace::ReadSegment segments[MAX_BLOCK_BUFFERS];
+        unsigned count = 0;
+        size_t total = 0;
+        for (unsigned i = 0; i < blockCount_ && total < len_; ++i)
         {
-            sender_->send(sendBuffer_.release());
-            return call_immediately(STATE(alloc_buffer));
+            size_t free = block_[i]->data()->free_space();
+            if (!free)
+            {
+                continue;
+            }
+            if (free > len_ - total)
+            {
+                free = len_ - total;
+            }
+            segments[count].dst = block_[i]->data()->append_ptr();
+            segments[count].len = free;
+            ++count;
+            total += free;
         }
-        size_t cnt = len_;
-        if (free < cnt)
+        if (!count)
         {
-            cnt = free;
+            send_block();
+            return call_immediately(STATE(alloc_buffer));
         }
-        uint8_t *ptr = sendBuffer_->data()->append_ptr();
-        MemorySpace::errorcode_t err;
-        size_t copied = space_->read(ofs_, ptr, cnt, &err, this);
-        sendBuffer_->data()->append_complete(copied);
+        MemorySpace::errorcode_t err = 0;
+        size_t copied =
+            space_->read_vector(ofs_, segments, count, &err, this);
         ofs_ += copied;
         len_ -= copied;
+        for (unsigned i = 0; i < blockCount_ && copied; ++i)
+        {
+            size_t len = block_[i]->data()->free_space();
+            if (len > copied)
+            {
+                len = copied;
+            }
+            block_[i]->data()->append_complete(len);
+            copied -= len;
+        }
         if (err == MemorySpace::ERROR_AGAIN)
         {
             return wait();
         }
         if (err == MemoryConfigDefs::ERROR_OUT_OF_BOUNDS)
         {
-            sender_->send(sendBuffer_.release());
-            senderCan_->close_stream();
-            return call_immediately(STATE(wait_for_close));
+            return call_immediately(STATE(send_last_block));
         }
         if (!err)
         {
@@ -195,12 +229,30 @@ private:
         else
         {
             LOG(INFO, "error reading input stream: %04x", err);
-            sender_->send(sendBuffer_.release());
+            send_block();
             senderCan_->close_stream(err);
             return call_immediately(STATE(wait_for_close));
         }
     }
 
+    /// Sends the current block and closes the stream.
+    Action send_last_block()
+    {
+        send_block();
+        senderCan_->close_stream();
+        return call_immediately(STATE(wait_for_close));
+    }
+
+    /// Hands over all buffers of the current block to the stream sender.
+    void send_block()
+    {
+        for (unsigned i = 0; i < blockCount_; ++i)
+        {
+            sender_->send(block_[i].release());
+        }
+        blockCount_ = 0;
+    }
+
     Action wait_for_close()
     {
         auto state = senderCan_->get_state();
@@ -232,13 +284,28 @@ private:
         return node_->iface()->stream_transport();
     }
 
-    /// This pool is used to allocate raw buffers to read data into from the
-    /// memory space. By keeping the count limited we can ensure that we only
-    /// carry 2 kbytes of data in RAM before it gets dumped into the CAN-bus
-    /// packets.
-    LimitedPool sendBufferPool_ {sizeof(RawBuffer), 2, rawBufferPool};
-    /// We keep reading into this buffer from the memory space.
-    ByteBufferPtr sendBuffer_;
+    /// @return how many raw buffers to read in one block.
+    static unsigned block_buffers()
+    {
+        int n = config_memory_stream_read_block_buffers();
+        if (n < 1)
+        {
+            return 1;
+        }
+        if ((unsigned)n > MAX_BLOCK_BUFFERS)
+        {
+            return MAX_BLOCK_BUFFERS;
+        }
+        return n;
+    }
+
+    /// Upper limit for the number of raw buffers in a block.
+    static constexpr unsigned MAX_BLOCK_BUFFERS = 8;
+
+    /// We keep reading into these buffers from the memory space.
+    ByteBufferPtr block_[MAX_BLOCK_BUFFERS];
+    /// Number of buffers in block_ that are allocated.
+    unsigned blockCount_ {0};
     /// Helper object for waiting.
     StateFlowTimer timer_ {this};
     /// Address to which we are sending the stream.
@@ -258,6 +325,13 @@ private:
     /// How many bytes are left to read. 0xFFFFFFFF if all bytes until EOF need
     /// to be read.
     uint32_t len_;
+    /// How many raw buffers to read in one block.
+    unsigned blockBuffers_;
+    /// This pool is used to allocate raw buffers to read data into from the
+    /// memory space. By keeping the count limited to two blocks we can ensure
+    /// that we only carry 2 * blockBuffers_ kbytes of data in RAM before it
+    /// gets dumped into the CAN-bus packets.
+    LimitedPool sendBufferPool_;
     ///
     ///
     StreamSenderCan *senderCan_;
@@ -36,9 +36,13 @@
 #ifndef _OPENLCB_ROUTNGLOGIC_HXX_
 #define _OPENLCB_ROUTNGLOGIC_HXX_
 
+#include <algorithm>
+#include <atomic>
 #include <set>
 #include <map>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "os/OS.hxx"
 #include "openlcb/EventHandler.hxx"
@@ -61,15 +65,53 @@ uint8_t event_range_to_bit_count(EventId *event);
  *
  * The routing table contains which direction to send addressed packets as well
  * as filters for the event IDs that have listeners in a given port.
+ *
+ * In the default LOCKED mode every call takes a mutex. In SNAPSHOT mode the
+ * lookups (check_pcer, lookup_port_for_address) do not lock: they read a
+ * compiled copy of the tables (an open-addressed hash table of addresses; per
+ * port a sorted array of events, and per mask length a sorted array of range
+ * bases). Changes are done under the mutex on the master tables, then a new
+ * snapshot is compiled and swapped in (read-copy-update). The old snapshot is
+ * freed after every reader that may have seen it has finished. Readers
+ * announce themselves on one of a few counter shards selected by the thread,
+ * so lookups from different threads rarely touch the same cache line.
+ *
+ * New and moved addresses are written into the current address snapshot in
+ * place while it is at most half full. It is rebuilt at four times the number
+ * of addresses when it fills up, so learning addresses takes amortized
+ * constant time. Other changes are linear in the table size, but
+ * registrations that do not change anything (the common case for traffic
+ * passing through) are detected on the snapshot without taking the mutex.
  */
 template <class Port, typename Address> class RoutingLogic
 {
 public:
-    RoutingLogic()
+    /// Selects how concurrent access to the tables is synchronized.
+    enum LockingMode
+    {
+        /// All calls take a mutex.
+        LOCKED,
+        /// Lookups read a snapshot without locking. Best for multi-threaded
+        /// routers.
+        SNAPSHOT,
+    };
+
+    /// Constructor.
+    /// @param mode how concurrent access is synchronized.
+    RoutingLogic(LockingMode mode = LOCKED)
+        : useSnapshot_(mode == SNAPSHOT)
     {
+        if (useSnapshot_)
+        {
+            shards_.reset(new ReaderShard[NUM_SHARDS]());
+            addressSnapshot_ = new AddressSnapshot(4);
+            eventSnapshot_ = new EventSnapshot;
+        }
     }
     ~RoutingLogic()
     {
+        delete addressSnapshot_.load();
+        delete eventSnapshot_.load();
     }
 
     /** Clears all entries in the routing table related to a given port, as the
@@ -93,6 +135,12 @@ public:
                 it.second = nullptr;
             }
         }
+        if (useSnapshot_)
+        {
+            // Addresses pointing to the port are left out of the snapshot.
+            publish_addresses();
+            publish_events();
+        }
     }
 
     /** Declares that a given node ID is reachable via a specific port. Used
@@ -104,8 +152,16 @@ public:
      */
     void add_node_id_to_route(Port *port, Address source)
     {
+        if (useSnapshot_ && lookup_port_for_address(source) == port)
+        {
+            return;
+        }
         OSMutexLock l(&lock_);
         addressRoutingTable_[source] = port;
+        if (useSnapshot_ && !update_address(source, port))
+        {
+            publish_addresses();
+        }
     }
 
     /** Looks up which port an addressed packet should be sent to.
@@ -117,6 +173,26 @@ public:
      */
     Port *lookup_port_for_address(Address dest)
     {
+        if (useSnapshot_)
+        {
+            ReadSection rs(this);
+            const AddressSnapshot *t = addressSnapshot_.load();
+            unsigned mask = (1u << t->bits_) - 1;
+            for (unsigned i = hash_bits(std::hash<Address>()(dest), t->bits_);;
+                 i = (i + 1) & mask)
+            {
+                // The address of a slot is valid once its port is set.
+                Port *p = t->slots_[i].port_.load(std::memory_order_acquire);
+                if (!p)
+                {
+                    return nullptr;
+                }
+                if (t->slots_[i].address_ == dest)
+                {
+                    return p;
+                }
+            }
+        }
         OSMutexLock l(&lock_);
         auto it = addressRoutingTable_.find(dest);
         if (it == addressRoutingTable_.end())
@@ -132,8 +208,16 @@ public:
      * that port. */
     void register_consumer(Port *port, EventId event)
     {
+        if (useSnapshot_ && snapshot_has_event(port, 0, event))
+        {
+            return;
+        }
         OSMutexLock l(&lock_);
         eventRoutingTable_[port].registeredConsumers_[0].insert(event);
+        if (useSnapshot_)
+        {
+            publish_events();
+        }
     }
 
     /** Declares that there is a consumer for the given event ID range on the
@@ -144,10 +228,18 @@ public:
      * method. */
     void register_consumer_range(Port *port, EventId encoded_range)
     {
-        OSMutexLock l(&lock_);
         uint8_t bit_count = event_range_to_bit_count(&encoded_range);
+        if (useSnapshot_ && snapshot_has_event(port, bit_count, encoded_range))
+        {
+            return;
+        }
+        OSMutexLock l(&lock_);
         eventRoutingTable_[port].registeredConsumers_[bit_count].insert(
             encoded_range);
+        if (useSnapshot_)
+        {
+            publish_events();
+        }
     }
 
     /** Declares that there is a producer for the given event ID on the given
@@ -184,6 +276,29 @@ public:
      * @return true if the given event has a consumer on the given port. */
     bool check_pcer(Port *port, EventId event)
     {
+        if (useSnapshot_)
+        {
+            ReadSection rs(this);
+            const PortEvents *pe = find_port(eventSnapshot_.load(), port);
+            if (!pe)
+            {
+                return false;
+            }
+            if (std::binary_search(
+                    pe->events_.begin(), pe->events_.end(), event))
+            {
+                return true;
+            }
+            for (const auto &r : pe->ranges_)
+            {
+                if (std::binary_search(
+                        r.bases_.begin(), r.bases_.end(), event & r.mask_))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
         OSMutexLock l(&lock_);
         auto ip = eventRoutingTable_.find(port);
         if (ip == eventRoutingTable_.end())
@@ -215,7 +330,306 @@ public:
     }
 
 private:
-    /// Protects all internal data structures.
+    /// Entry of the compiled address table.
+    struct AddressSlot
+    {
+        /// Node address. Written only while port_ is null.
+        Address address_;
+        /// Where the address is routed to. Null for an empty slot.
+        std::atomic<Port *> port_ {nullptr};
+    };
+
+    /// Compiled address table: hash table with linear probing. Entries are
+    /// added and changed in place, but never removed.
+    struct AddressSnapshot
+    {
+        /// Constructor. @param bits log2 of the number of slots.
+        AddressSnapshot(unsigned bits)
+            : bits_(bits)
+            , slots_(new AddressSlot[1u << bits])
+        {
+        }
+
+        /// log2 of the number of slots.
+        const unsigned bits_;
+        /// Number of non-empty slots. Only used by the writers.
+        unsigned used_ {0};
+        /// Hash table.
+        std::unique_ptr<AddressSlot[]> slots_;
+    };
+
+    /// Event ranges with a given mask length.
+    struct RangeSet
+    {
+        /// Which bits of the event ID to compare. 0 for the full range.
+        EventId mask_;
+        /// Sorted base values of the ranges.
+        std::vector<EventId> bases_;
+    };
+
+    /// Compiled event table of one port.
+    struct PortEvents
+    {
+        /// Which port this is.
+        Port *port_;
+        /// Sorted individual events.
+        std::vector<EventId> events_;
+        /// Ranges, grouped by mask length.
+        std::vector<RangeSet> ranges_;
+    };
+
+    /// Compiled event table: sorted by port.
+    typedef std::vector<PortEvents> EventSnapshot;
+
+    /// log2 of the number of reader counter shards.
+    static constexpr unsigned SHARD_BITS = 3;
+    /// Number of reader counter shards.
+    static constexpr unsigned NUM_SHARDS = 1u << SHARD_BITS;
+
+    /// Reader counters for the two epochs, padded to a cache line.
+    struct ReaderShard
+    {
+        /// Number of readers in the critical section, per epoch.
+        std::atomic<unsigned> count_[2];
+        /// Keeps different shards in different cache lines.
+        char padding_[64 - 2 * sizeof(std::atomic<unsigned>)];
+    };
+
+    /// Maps a hash value to a table index.
+    /// @param h hash value (e.g. from std::hash).
+    /// @param bits log2 of the table size.
+    /// @return index in 0 .. 2^bits - 1.
+    static unsigned hash_bits(size_t h, unsigned bits)
+    {
+        uint32_t x = (uint32_t)h ^ (uint32_t)((uint64_t)h >> 32);
+        // Fibonacci hashing: the top bits of the product are well mixed.
+        return (x * 0x9E3779B1u) >> (32 - bits);
+    }
+
+    /// RAII class for a lock-free reader critical section. While it exists,
+    /// the snapshots that were current at the beginning are not freed.
+    class ReadSection
+    {
+    public:
+        /// Enters the critical section.
+        /// @param parent the routing table to read.
+        ReadSection(RoutingLogic *parent)
+        {
+            unsigned shard =
+                hash_bits((uintptr_t)os_thread_self(), SHARD_BITS);
+            count_ = &parent->shards_[shard].count_[parent->epoch_.load() & 1];
+            // Sequentially consistent with the writer's pointer exchange and
+            // counter loads: either the writer sees this reader, or this
+            // reader sees the new snapshot.
+            count_->fetch_add(1);
+        }
+
+        ~ReadSection()
+        {
+            count_->fetch_sub(1, std::memory_order_release);
+        }
+
+    private:
+        /// The counter that was incremented.
+        std::atomic<unsigned> *count_;
+    };
+
+    /// Waits until all readers that might have seen a snapshot before the
+    /// last exchange have left their critical section. Called with lock_
+    /// held.
+    void wait_for_readers()
+    {
+        for (unsigned phase = 0; phase < 2; ++phase)
+        {
+            unsigned old_epoch = epoch_.fetch_add(1) & 1;
+            for (unsigned i = 0; i < NUM_SHARDS; ++i)
+            {
+                while (shards_[i].count_[old_epoch].load() != 0)
+                {
+                    usleep(1);
+                }
+            }
+        }
+    }
+
+    /// Stores an address in the current address snapshot without copying
+    /// it. Called with lock_ held.
+    /// @param a node address.
+    /// @param port where a is routed to.
+    /// @return false if the snapshot has to be rebuilt instead.
+    bool update_address(Address a, Port *port)
+    {
+        if (!port)
+        {
+            // Removing an entry would break the probe sequences.
+            return false;
+        }
+        AddressSnapshot *t = addressSnapshot_.load(std::memory_order_relaxed);
+        unsigned mask = (1u << t->bits_) - 1;
+        unsigned i = hash_bits(std::hash<Address>()(a), t->bits_);
+        for (; t->slots_[i].port_.load(std::memory_order_relaxed);
+             i = (i + 1) & mask)
+        {
+            if (t->slots_[i].address_ == a)
+            {
+                t->slots_[i].port_.store(port, std::memory_order_release);
+                return true;
+            }
+        }
+        if (2 * (t->used_ + 1) > mask + 1)
+        {
+            return false;
+        }
+        t->slots_[i].address_ = a;
+        t->slots_[i].port_.store(port, std::memory_order_release);
+        ++t->used_;
+        return true;
+    }
+
+    /// Compiles and swaps in a new address snapshot. Called with lock_ held.
+    void publish_addresses()
+    {
+        unsigned count = 0;
+        for (const auto &it : addressRoutingTable_)
+        {
+            if (it.second)
+            {
+                ++count;
+            }
+        }
+        // Leaves room for as many new addresses as there are now, so that
+        // the cost of the rebuild is spread over them.
+        unsigned bits = 4;
+        while ((1u << bits) < 4 * count)
+        {
+            ++bits;
+        }
+        AddressSnapshot *t = new AddressSnapshot(bits);
+        unsigned mask = (1u << bits) - 1;
+        for (const auto &it : addressRoutingTable_)
+        {
+            if (!it.second)
+            {
+                continue;
+            }
+            unsigned i = hash_bits(std::hash<Address>()(it.first), bits);
+            while (t->slots_[i].port_.load(std::memory_order_relaxed))
+            {
+                i = (i + 1) & mask;
+            }
+            t->slots_[i].address_ = it.first;
+            t->slots_[i].port_.store(it.second, std::memory_order_relaxed);
+        }
+        t->used_ = count;
+        AddressSnapshot *old = addressSnapshot_.exchange(t);
+        wait_for_readers();
+        delete old;
+    }
+
+    /// Compiles and swaps in a new event snapshot. Called with lock_ held.
+    void publish_events()
+    {
+        EventSnapshot *t = new EventSnapshot;
+        t->reserve(eventRoutingTable_.size());
+        // eventRoutingTable_ is a std::map, thus already sorted by port.
+        for (const auto &ip : eventRoutingTable_)
+        {
+            t->emplace_back();
+            PortEvents &pe = t->back();
+            pe.port_ = ip.first;
+            for (const auto &im : ip.second.registeredConsumers_)
+            {
+                if (im.second.empty())
+                {
+                    continue;
+                }
+                if (im.first == 0)
+                {
+                    pe.events_.assign(im.second.begin(), im.second.end());
+                    continue;
+                }
+                pe.ranges_.emplace_back();
+                RangeSet &r = pe.ranges_.back();
+                r.mask_ =
+                    im.first == 64 ? 0 : ~((UINT64_C(1) << im.first) - 1);
+                r.bases_.assign(im.second.begin(), im.second.end());
+                if (im.first == 64)
+                {
+                    // Any base matches everything.
+                    r.bases_.assign(1, 0);
+                }
+            }
+        }
+        EventSnapshot *old = eventSnapshot_.exchange(t);
+        wait_for_readers();
+        delete old;
+    }
+
+    /// Looks up a port in an event snapshot.
+    /// @param t snapshot.
+    /// @param port port to look for.
+    /// @return the port's events, or nullptr if the port has none.
+    static const PortEvents *find_port(const EventSnapshot *t, Port *port)
+    {
+        auto it = std::lower_bound(t->begin(), t->end(), port,
+            [](const PortEvents &e, Port *p) { return e.port_ < p; });
+        if (it == t->end() || it->port_ != port)
+        {
+            return nullptr;
+        }
+        return &*it;
+    }
+
+    /// Checks whether the current event snapshot already has an event or
+    /// range registered.
+    /// @param port the port of the registration.
+    /// @param bit_count number of mask bits, 0 for an individual event.
+    /// @param base the event or the base of the range.
+    /// @return true if registering it would not change anything.
+    bool snapshot_has_event(Port *port, uint8_t bit_count, EventId base)
+    {
+        ReadSection rs(this);
+        const PortEvents *pe = find_port(eventSnapshot_.load(), port);
+        if (!pe)
+        {
+            return false;
+        }
+        if (bit_count == 0)
+        {
+            return std::binary_search(
+                pe->events_.begin(), pe->events_.end(), base);
+        }
+        EventId mask =
+            bit_count == 64 ? 0 : ~((UINT64_C(1) << bit_count) - 1);
+        for (const auto &r : pe->ranges_)
+        {
+            if (r.mask_ == mask)
+            {
+                return std::binary_search(
+                    r.bases_.begin(), r.bases_.end(), base & mask);
+            }
+        }
+        return false;
+    }
+
+    /// true if lookups use the snapshots.
+    const bool useSnapshot_;
+
+    /// Reader counters (SNAPSHOT mode).
+    std::unique_ptr<ReaderShard[]> shards_;
+
+    /// Selects which counter of the shards new readers increment. Advanced
+    /// by the writers.
+    std::atomic<unsigned> epoch_ {0};
+
+    /// Current compiled address table (SNAPSHOT mode).
+    std::atomic<AddressSnapshot *> addressSnapshot_ {nullptr};
+
+    /// Current compiled event table (SNAPSHOT mode).
+    std::atomic<EventSnapshot *> eventSnapshot_ {nullptr};
+
+    /// Protects all internal data structures. In SNAPSHOT mode protects the
+    /// master tables below and serializes the writers.
     OSMutex lock_;
 
     /// Stores all known addresses and which port they route to.
@@ -52,6 +52,7 @@ void StreamReceiverCan::announced_stream()
     pendingInit_ = 0;
     pendingCancel_ = 0;
     isWaiting_ = 0;
+    nextWindowGranted_ = 0;
 
     if (!request()->streamWindowSize_)
     {
@@ -133,6 +134,14 @@ void StreamReceiverCan::handle_stream_initiate(Buffer<GenMessage> *message)
     {
         request()->streamWindowSize_ = proposed_window;
     }
+    if (windowMode_ == WINDOW_ADAPTIVE &&
+        request()->streamWindowSize_ > RawData::MAX_SIZE)
+    {
+        // Whole raw buffers per window, so that no partially filled buffer
+        // has to be flushed at the window boundaries.
+        request()->streamWindowSize_ -=
+            request()->streamWindowSize_ % RawData::MAX_SIZE;
+    }
 
     streamWindowRemaining_ = request()->streamWindowSize_;
     totalByteCount_ = 0;
@@ -157,7 +166,7 @@ void StreamReceiverCan::handle_bytes_received(const uint8_t *data, size_t len)
             mainBufferPool->alloc(&currentBuffer_);
             // Add an empty raw buffer to it.
             RawBufferPtr rb;
-            if (streamWindowRemaining_ <= RawData::MAX_SIZE)
+            if (streamWindowRemaining_ <= RawData::MAX_SIZE && lastBuffer_)
             {
                 // We need to use the last raw buffer.
                 rb = std::move(lastBuffer_);
@@ -169,7 +178,14 @@ void StreamReceiverCan::handle_bytes_received(const uint8_t *data, size_t len)
             }
             currentBuffer_->data()->set_from(std::move(rb), 0);
         }
-        size_t copied = currentBuffer_->data()->append(data, len);
+        size_t max_len = len;
+        if (nextWindowGranted_ && streamWindowRemaining_ &&
+            max_len > streamWindowRemaining_)
+        {
+            // The frame continues in the next window.
+            max_len = streamWindowRemaining_;
+        }
+        size_t copied = currentBuffer_->data()->append(data, max_len);
         data += copied;
         len -= copied;
         totalByteCount_ += copied;
@@ -187,11 +203,18 @@ void StreamReceiverCan::handle_bytes_received(const uint8_t *data, size_t len)
             // Sends off the buffer and clears currentBuffer_.
             request()->target_->send(currentBuffer_.release());
         }
+        if (!streamWindowRemaining_ && nextWindowGranted_ && !streamClosed_)
+        {
+            // The sender already got the proceed for the next window.
+            nextWindowGranted_ = 0;
+            lastBuffer_ = std::move(nextLastBuffer_);
+            streamWindowRemaining_ = request()->streamWindowSize_;
+        }
     } // while len > 0
-    if (!streamWindowRemaining_)
+    if (!streamWindowRemaining_ || early_ack_due())
     {
         // wake up state flow to send ack to the stream
-        notify();
+        wakeup_if_waiting();
     }
 }
 
@@ -299,7 +322,8 @@ private:
     StreamReceiverCan *parent_;
 };
 
-StreamReceiverCan::StreamReceiverCan(IfCan *interface, uint8_t local_stream_id)
+StreamReceiverCan::StreamReceiverCan(
+    IfCan *interface, uint8_t local_stream_id, WindowMode mode)
     : StreamReceiverInterface(interface)
     , dataHandler_(new StreamDataHandler(this))
     , assignedStreamId_(local_stream_id)
@@ -307,6 +331,8 @@ StreamReceiverCan::StreamReceiverCan(IfCan *interface, uint8_t local_stream_id)
     , pendingInit_(0)
     , pendingCancel_(0)
     , isWaiting_(0)
+    , nextWindowGranted_(0)
+    , windowMode_(mode)
 { }
 
 StreamReceiverCan::~StreamReceiverCan()
@@ -343,6 +369,7 @@ StateFlowBase::Action StreamReceiverCan::wakeup()
             // Sends off the buffer and clears currentBuffer_.
             request()->target_->send(currentBuffer_.release());
         }
+        nextLastBuffer_.reset();
         return return_with_error(StreamReceiveRequest::ERROR_CANCELED);
     }
     if (pendingInit_)
@@ -361,12 +388,18 @@ StateFlowBase::Action StreamReceiverCan::wakeup()
                 // Sends off the buffer and clears currentBuffer_.
                 request()->target_->send(currentBuffer_.release());
             }
+            nextLastBuffer_.reset();
             return return_ok();
         }
         // Need to send an ack.
         return call_immediately(STATE(window_reached));
     }
-    return wait();
+    if (early_ack_due())
+    {
+        // Half of the window is in; the sender may go on with the next one.
+        return call_immediately(STATE(window_reached));
+    }
+    return wait_for_wakeup();
 }
 
 StateFlowBase::Action StreamReceiverCan::init_reply()
@@ -400,8 +433,17 @@ StateFlowBase::Action StreamReceiverCan::window_reached()
 
 StateFlowBase::Action StreamReceiverCan::have_raw_buffer()
 {
-    lastBuffer_.reset(get_allocation_result<RawData>(nullptr));
-    streamWindowRemaining_ = request()->streamWindowSize_;
+    if (streamWindowRemaining_)
+    {
+        // Early ack in adaptive mode; this buffer belongs to the next window.
+        nextLastBuffer_.reset(get_allocation_result<RawData>(nullptr));
+        nextWindowGranted_ = 1;
+    }
+    else
+    {
+        lastBuffer_.reset(get_allocation_result<RawData>(nullptr));
+        streamWindowRemaining_ = request()->streamWindowSize_;
+    }
     send_message(node(), Defs::MTI_STREAM_PROCEED, request()->src_,
         StreamDefs::create_data_proceed(
             request()->srcStreamId_, request()->localStreamId_));
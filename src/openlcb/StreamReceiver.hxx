@@ -49,12 +49,26 @@ namespace openlcb
 class StreamReceiverCan : public StreamReceiverInterface
 {
 public:
+    /// How the receiver acknowledges the stream windows.
+    enum WindowMode
+    {
+        /// Sends the stream proceed message when the window is completely
+        /// received. The sender stalls for a round trip after every window.
+        WINDOW_FIXED,
+        /// Sends the stream proceed message for the next window when half of
+        /// the current window is received, so that the sender always has
+        /// data in flight. The window is aligned to whole raw buffers.
+        WINDOW_ADAPTIVE
+    };
+
     /// Constructor.
     ///
     /// @param interface the CAN interface that owns this stream receiver.
     /// @param local_stream_id what should be the local stream ID for the
     /// streams used for this receiver.
-    StreamReceiverCan(IfCan *interface, uint8_t local_stream_id);
+    /// @param mode how to acknowledge stream windows.
+    StreamReceiverCan(IfCan *interface, uint8_t local_stream_id,
+        WindowMode mode = WINDOW_FIXED);
 
     ~StreamReceiverCan();
 
@@ -80,7 +94,7 @@ private:
 
     Action wait_for_wakeup()
     {
-        if (pendingCancel_)
+        if (pendingCancel_ || early_ack_due())
         {
             return call_immediately(STATE(wakeup));
         }
@@ -96,13 +110,34 @@ private:
     Action init_reply();
     Action init_buffer_ready();
 
-    /// Invoked when the stream window runs out. Maybe waits for the data to be
-    /// consumed below the low-watermark.
+    /// Invoked when the stream window runs out, or in adaptive mode when half
+    /// of it is received. Maybe waits for the data to be consumed below the
+    /// low-watermark.
     Action window_reached();
     /// Called when the allocation of the raw buffer is successful. Sends off
     /// the stream proceed message.
     Action have_raw_buffer();
 
+    /// @return true if in adaptive mode the stream proceed for the next
+    /// window should be sent now.
+    bool early_ack_due()
+    {
+        return windowMode_ == WINDOW_ADAPTIVE && !nextWindowGranted_ &&
+            !streamClosed_ && streamWindowRemaining_ &&
+            streamWindowRemaining_ <= request()->streamWindowSize_ / 2;
+    }
+
+    /// Wakes up the state flow if it is waiting for an event from the
+    /// handlers.
+    void wakeup_if_waiting()
+    {
+        if (isWaiting_)
+        {
+            isWaiting_ = 0;
+            notify();
+        }
+    }
+
     /// Invoked by the GenericHandler when a stream initiate message arrives.
     ///
     /// @param message buffer with stream initiate message.
@@ -157,6 +192,10 @@ private:
     /// comes from the lastBufferPool_ to function as throttling signal.
     RawBufferPtr lastBuffer_;
 
+    /// In adaptive mode, the last buffer of the next stream window, for which
+    /// the stream proceed was already sent.
+    RawBufferPtr nextLastBuffer_;
+
     /// Helper object that receives the actual stream CAN frames.
     std::unique_ptr<StreamDataHandler> dataHandler_;
 
@@ -178,6 +217,11 @@ private:
     uint8_t pendingCancel_ : 1;
     /// 1 if we are currently waiting for a notification
     uint8_t isWaiting_ : 1;
+    /// 1 if the stream proceed for the window after the current one was
+    /// already sent (adaptive mode).
+    uint8_t nextWindowGranted_ : 1;
+    /// How to acknowledge stream windows.
+    WindowMode windowMode_;
 }; // class StreamReceiver
 
 } // namespace openlcb
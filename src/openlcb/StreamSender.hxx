@@ -585,8 +585,10 @@ private:
     uint8_t streamAdditionalFlags_ {0};
     /// Total stream window size. @todo fill in
     uint16_t streamWindowSize_ {StreamDefs::MAX_PAYLOAD};
-    /// Remaining stream window size. @todo fill in
-    uint16_t streamWindowRemaining_ {0};
+    /// How many bytes we may send before we have to wait for a stream
+    /// proceed. With a receiver that acks early this covers the rest of the
+    /// current window plus the next one, so it does not fit 16 bits.
+    uint32_t streamWindowRemaining_ {0};
     /// When the stream process fails, this variable contains an error code.
     uint32_t errorCode_ {0};
     /// Source of buffers for outgoing CAN frames. Limtedpool is allocating and
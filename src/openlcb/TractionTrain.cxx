@@ -56,10 +56,6 @@ TrainNode::~TrainNode()
 
 TrainNodeWithConsist::~TrainNodeWithConsist()
 {
-    while (!consistSlaves_.empty())
-    {
-        delete consistSlaves_.pop_front();
-    }
 }
 
 DefaultTrainNode::~DefaultTrainNode()
@@ -461,65 +457,95 @@ struct TrainService::Impl
             }
         }
 
-        Action maybe_forward_consist()
+        /// Checks whether the current message should be forwarded to a
+        /// consist member.
+        /// @param dst the consist member.
+        /// @param flags the consist flags of the member.
+        /// @return true if the message has to be forwarded to dst.
+        bool should_forward(NodeID dst, uint8_t flags)
         {
-            auto* train_node = this->train_node();
-            unsigned count = train_node->query_consist_length();
-            if (count <= nextConsistIndex_)
-                return release_and_exit();
-            uint8_t flags = 0;
-            NodeID dst = train_node->query_consist(nextConsistIndex_, &flags);
             if (iface()->matching_node(nmsg()->src, NodeHandle(dst)))
             {
-                ++nextConsistIndex_;
-                return again();
+                // Do not send the command back to where it came from.
+                return false;
             }
             uint8_t cmd = payload()[0] & TractionDefs::REQ_MASK;
-            bool flip_speed = false;
-            if (cmd == TractionDefs::REQ_SET_SPEED) {
-                if (flags & TractionDefs::CNSTFLAGS_REVERSE) {
-                    flip_speed = true;
-                }
-            } else if (cmd == TractionDefs::REQ_SET_FN) {
+            if (cmd == TractionDefs::REQ_SET_FN) {
                 uint32_t address = payload()[1];
                 address <<= 8;
                 address |= payload()[2];
                 address <<= 8;
                 address |= payload()[3];
                 if (address == 0) {
-                    if ((flags & TractionDefs::CNSTFLAGS_LINKF0) == 0) {
-                        // skip
-                        ++nextConsistIndex_;
-                        return again();
-                    }
+                    return (flags & TractionDefs::CNSTFLAGS_LINKF0) != 0;
                 } else {
-                    if ((flags & TractionDefs::CNSTFLAGS_LINKFN) == 0) {
-                        // skip
-                        ++nextConsistIndex_;
-                        return again();
-                    }
+                    return (flags & TractionDefs::CNSTFLAGS_LINKFN) != 0;
                 }
             }
-            if (count == nextConsistIndex_ + 1u)
+            return true;
+        }
+
+        /// Turns a message into the forwarded copy for a consist member. Does
+        /// not access the current message, which may have been transferred.
+        /// @param m the message, already containing the incoming payload.
+        /// @param src the node ID of this train.
+        /// @param dst the consist member.
+        /// @param flags the consist flags of the member.
+        void prepare_forward(
+            GenMessage *m, NodeID src, NodeID dst, uint8_t flags)
+        {
+            m->src = NodeHandle(src);
+            m->dst = NodeHandle(dst);
+            m->dstNode = nullptr;
+            if (((m->payload[0] & TractionDefs::REQ_MASK) ==
+                    TractionDefs::REQ_SET_SPEED) &&
+                (flags & TractionDefs::CNSTFLAGS_REVERSE))
             {
-                // last node: we can transfer the message.
-                auto *b = transfer_message();
-                b->data()->src = NodeHandle(train_node->node_id());
-                b->data()->dst = NodeHandle(dst);
-                b->data()->dstNode = nullptr;
-                if (flip_speed) {
-                    b->data()->payload[1] ^= 0x80;
-                }
-                b->data()->payload[0] |= TractionDefs::REQ_LISTENER;
-                iface()->addressed_message_write_flow()->send(b);
-                return exit();
+                m->payload[1] ^= 0x80;
             }
-            else
+            m->payload[0] |= TractionDefs::REQ_LISTENER;
+        }
+
+        /// Forwards the current message to all consist members in one burst,
+        /// starting at nextConsistIndex_. The last member gets the incoming
+        /// message buffer.
+        Action maybe_forward_consist()
+        {
+            auto* train_node = this->train_node();
+            unsigned count = train_node->query_consist_length();
+            for (; nextConsistIndex_ < count; ++nextConsistIndex_)
             {
-                return allocate_and_call(
-                    iface()->addressed_message_write_flow(),
-                    STATE(forward_consist));
+                uint8_t flags = 0;
+                NodeID dst =
+                    train_node->query_consist(nextConsistIndex_, &flags);
+                if (!should_forward(dst, flags))
+                {
+                    continue;
+                }
+                if (count == nextConsistIndex_ + 1u)
+                {
+                    // last node: we can transfer the message.
+                    auto *b = transfer_message();
+                    prepare_forward(
+                        b->data(), train_node->node_id(), dst, flags);
+                    iface()->addressed_message_write_flow()->send(b);
+                    return exit();
+                }
+                auto *b = iface()->addressed_message_write_flow()->alloc();
+                if (!b)
+                {
+                    // The pool is limited; waits for a buffer.
+                    return allocate_and_call(
+                        iface()->addressed_message_write_flow(),
+                        STATE(forward_consist));
+                }
+                b->data()->reset(message()->data()->mti,
+                    train_node->node_id(), NodeHandle(dst),
+                    message()->data()->payload);
+                prepare_forward(b->data(), train_node->node_id(), dst, flags);
+                iface()->addressed_message_write_flow()->send(b);
             }
+            return release_and_exit();
         }
 
         Action forward_consist()
@@ -537,13 +563,7 @@ struct TrainService::Impl
             }
             b->data()->reset(message()->data()->mti, train_node()->node_id(),
                              NodeHandle(dst), message()->data()->payload);
-            b->data()->payload[0] |= TractionDefs::REQ_LISTENER;
-            if (((payload()[0] & TractionDefs::REQ_MASK) ==
-                    TractionDefs::REQ_SET_SPEED) &&
-                (flags & TractionDefs::CNSTFLAGS_REVERSE))
-            {
-                b->data()->payload[1] ^= 0x80;
-            }
+            prepare_forward(b->data(), train_node()->node_id(), dst, flags);
             iface()->addressed_message_write_flow()->send(b);
             ++nextConsistIndex_;
             return call_immediately(STATE(maybe_forward_consist));
@@ -36,6 +36,7 @@
 #define _OPENLCB_TRACTIONTRAIN_HXX_
 
 #include <set>
+#include <vector>
 
 #include "executor/Service.hxx"
 #include "openlcb/DefaultNodeRegistry.hxx"
@@ -128,8 +129,7 @@ public:
     virtual int query_consist_length() = 0;
 };
 
-/// Linked list entry for all registered consist clients for a given train
-/// node.
+/// Entry for all registered consist clients for a given train node.
 struct ConsistEntry : public QMember
 {
     /// Creates a new consist entry storage.
@@ -193,16 +193,15 @@ public:
         {
             return false;
         }
-        auto it = consistSlaves_.begin();
-        for (; it != consistSlaves_.end(); ++it)
+        for (auto &e : consistSlaves_)
         {
-            if (it->get_slave() == tgt)
+            if (e.get_slave() == tgt)
             {
-                it->set_flags(flags);
+                e.set_flags(flags);
                 return false;
             }
         }
-        consistSlaves_.insert(it, new ConsistEntry(tgt, flags));
+        consistSlaves_.emplace_back(tgt, flags);
         return true;
     }
 
@@ -214,9 +213,7 @@ public:
         {
             if (it->get_slave() == tgt)
             {
-                auto* p = it.operator->();
                 consistSlaves_.erase(it);
-                delete p;
                 return true;
             }
         }
@@ -227,31 +224,23 @@ public:
      * fewer than id consist targets. id is zero-based. */
     NodeID query_consist(int id, uint8_t* flags) override
     {
-        int k = 0;
-        for (auto it = consistSlaves_.begin();
-             it != consistSlaves_.end(); ++it, ++k)
+        if (id < 0 || (unsigned)id >= consistSlaves_.size())
         {
-            if (k == id)
-            {
-                if (flags) *flags = it->get_flags();
-                return it->get_slave();
-            }
+            return 0;
         }
-        return 0;
+        if (flags) *flags = consistSlaves_[id].get_flags();
+        return consistSlaves_[id].get_slave();
     }
 
     /** Returns the number of slaves in this consist. */
     int query_consist_length() override
     {
-        int ret = 0;
-        for (auto it = consistSlaves_.begin(); it != consistSlaves_.end();
-             ++it, ++ret)
-        {
-        }
-        return ret;
+        return consistSlaves_.size();
     }
 
-    TypedQueue<ConsistEntry> consistSlaves_;
+    /// Consist targets in the order they were added. Indexed, so that
+    /// forwarding a command to all targets is linear in the consist length.
+    std::vector<ConsistEntry> consistSlaves_;
 };
 
 /// Default implementation of a train node.
@@ -53,6 +53,14 @@ DEFAULT_CONST(num_datagram_registry_entries, 2);
  * happen concurrently. */
 DEFAULT_CONST(num_datagram_clients, 2);
 
+/** Number of multi-frame incoming datagrams that the CAN interface can
+ * reassemble at the same time. */
+DEFAULT_CONST(num_datagram_reassembly_buffers, 4);
+
+/** Milliseconds after the last received frame when a partially received
+ * incoming datagram gets dropped. */
+DEFAULT_CONST(datagram_reassembly_timeout_msec, 3000);
+
 /** Number of stream senders. This is how many stream send operations can
  * happen concurrently. */
 DEFAULT_CONST(num_stream_senders, 1);
@@ -78,3 +86,27 @@ DEFAULT_CONST(bulk_alias_num_can_frames, 20);
 /** Default number of bytes in maximum stream window size for { @ref
  * StreamReceiver }. */
 DEFAULT_CONST(stream_receiver_default_window_size, 2 * 1024);
+
+/** Number of identified messages per batch when answering Identify Global;
+ * 0 to disable batching. */
+DEFAULT_CONST(event_identify_batch_size, 0);
+
+#if defined(__linux__) || defined(__MACH__) || defined(__WINNT__)
+/** Hosts have plenty of memory for the flat alias routing table. */
+DEFAULT_CONST_TRUE(can_filter_flat_table);
+/** Hosts read memory spaces into streams in 4 kbyte blocks. */
+DEFAULT_CONST(memory_stream_read_block_buffers, 4);
+/** Hosts cache the config file during configuration updates. */
+DEFAULT_CONST(config_update_snapshot_max_size, 65536);
+/** Hosts talk to many remote nodes, e.g. throttles on a command station. */
+DEFAULT_CONST(remote_alias_parallel_lookups, 8);
+#else
+/** Small devices use the multimap for alias routing. */
+DEFAULT_CONST_FALSE(can_filter_flat_table);
+/** Small devices keep 2 kbytes of stream read data in RAM. */
+DEFAULT_CONST(memory_stream_read_block_buffers, 1);
+/** Small devices read every config field from the file. */
+DEFAULT_CONST(config_update_snapshot_max_size, 0);
+/** Small devices run two destination alias lookups at a time. */
+DEFAULT_CONST(remote_alias_parallel_lookups, 2);
+#endif
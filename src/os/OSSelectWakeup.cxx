@@ -112,6 +112,34 @@ int OSSelectWakeup::select(int nfds, fd_set *readfds,
     return ret;
 }
 
+#if OPENMRN_HAVE_EPOLL
+int OSSelectWakeup::epoll_wait(int epfd, struct epoll_event *events,
+                               int max_events, long long deadline_nsec)
+{
+    {
+        AtomicHolder l(this);
+        inSelect_ = true;
+        if (pendingWakeup_)
+        {
+            deadline_nsec = 0;
+        }
+    }
+    // Rounds up so that we never wake up before the next timer is due.
+    long long msec = (deadline_nsec + 999999) / 1000000;
+    if (msec > INT32_MAX)
+    {
+        msec = INT32_MAX;
+    }
+    int ret = ::epoll_pwait(epfd, events, max_events, msec, &origMask_);
+    {
+        AtomicHolder l(this);
+        pendingWakeup_ = false;
+        inSelect_ = false;
+    }
+    return ret;
+}
+#endif // OPENMRN_HAVE_EPOLL
+
 #ifdef ESP_PLATFORM
 #include "freertos_includes.h"
 
@@ -48,6 +48,10 @@
 #include <signal.h>
 #endif
 
+#if OPENMRN_HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef __WINNT__
 #include <winsock2.h>
 #elif OPENMRN_HAVE_SELECT
@@ -201,6 +205,22 @@ public:
     int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
                long long deadline_nsec);
 
+#if OPENMRN_HAVE_EPOLL
+    /** Same as select(), but waits on an epoll instance.
+     *
+     * @param epfd is the epoll file descriptor.
+     * @param events will be filled with the ready events.
+     * @param max_events is the length of the events array.
+     * @param deadline_nsec is the maximum time to sleep if no fd activity and
+     * no wakeup happens. Rounded up to milliseconds.
+     *
+     * @return what epoll_wait would return (number of events, 0 in case of
+     * timeout), or -1 and errno==EINTR if woken up asynchronously.
+     */
+    int epoll_wait(int epfd, struct epoll_event *events, int max_events,
+                   long long deadline_nsec);
+#endif
+
 private:
 #ifdef ESP_PLATFORM
     void esp_allocate_vfs_fd();
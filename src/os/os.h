@@ -579,6 +579,41 @@ OS_INLINE int os_mutex_lock(os_mutex_t *mutex)
 #endif
 }
 
+/** Lock a mutex if it is free, without blocking.
+ * @param mutex address of mutex handle to lock
+ * @return 0 upon succes, EBUSY if the mutex is held by someone (including
+ * the calling thread for a non-recursive mutex)
+ */
+OS_INLINE int os_mutex_trylock(os_mutex_t *mutex)
+{
+#if OPENMRN_FEATURE_MUTEX_FREERTOS
+    if (mutex->sem == NULL)
+    {
+        // Not created yet, so nobody holds it.
+        return os_mutex_lock(mutex);
+    }
+    portBASE_TYPE ret;
+    if (mutex->recursive)
+    {
+        ret = xSemaphoreTakeRecursive(mutex->sem, 0);
+    }
+    else
+    {
+        ret = xSemaphoreTake(mutex->sem, 0);
+    }
+    return ret == pdTRUE ? 0 : EBUSY;
+#elif OPENMRN_FEATURE_MUTEX_FAKE
+    if (mutex->locked && !mutex->recursive)
+    {
+        return EBUSY;
+    }
+    mutex->locked++;
+    return 0;
+#elif OPENMRN_FEATURE_MUTEX_PTHREAD
+    return pthread_mutex_trylock(mutex);
+#endif
+}
+
 /** Unock a mutex.
  * @param mutex address of mutex handle to unlock
  * @return 0 upon succes or error number upon failure
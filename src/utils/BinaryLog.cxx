@@ -0,0 +1,589 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file BinaryLog.cxx
+ *
+ * Deferred logging: log lines are stored in binary form (format string
+ * pointer and raw arguments) and rendered to text later.
+ *
+ * @author agent
+ * @date 17 Oct 2026
+ */
+
+#include "utils/BinaryLog.hxx"
+
+#include <atomic>
+#include <stdio.h>
+
+#include "nmranet_config.h"
+#include "os/os.h"
+#include "utils/logging.h"
+
+namespace
+{
+
+/// Ring buffer of encoded records written by a single thread.
+struct Ring
+{
+    /// Thread that writes this ring.
+    os_thread_t thread;
+    /// False if the thread writing this ring exited. Protected by drainLock.
+    bool inUse {true};
+    /// Write offset (not wrapped). Only modified by the owning thread.
+    std::atomic<uint32_t> head {0};
+    /// Read offset (not wrapped). Only modified by drain().
+    std::atomic<uint32_t> tail {0};
+    /// Number of records dropped because the ring was full.
+    std::atomic<uint32_t> dropped {0};
+    /// Record storage, ring_size() bytes.
+    std::unique_ptr<uint64_t[]> data;
+};
+
+/// @return the size of each ring in bytes.
+inline uint32_t ring_size()
+{
+    return config_binary_log_ring_size();
+}
+
+/// Rings of the threads that have logged so far.
+Ring *rings[BinaryLog::MAX_THREADS];
+/// Number of valid entries in rings.
+std::atomic<unsigned> numRings {0};
+/// Orders records across threads.
+std::atomic<uint32_t> nextSeq {0};
+/// Total drop count at the end of the last drain().
+unsigned reportedDrops = 0;
+/// Serializes drain() calls and the registration of new rings.
+os_mutex_t drainLock = OS_MUTEX_INITIALIZER;
+
+#if OPENMRN_FEATURE_MUTEX_PTHREAD
+/// Thread-specific key holding the ring of the current thread.
+pthread_key_t ringKey;
+/// Creates ringKey.
+pthread_once_t ringKeyOnce = PTHREAD_ONCE_INIT;
+
+/// Called by pthreads when a thread that logged exits. Frees up its ring for
+/// another thread. @param ring the ring of the exiting thread.
+void ring_thread_exit(void *ring)
+{
+    os_mutex_lock(&drainLock);
+    static_cast<Ring *>(ring)->inUse = false;
+    os_mutex_unlock(&drainLock);
+}
+
+/// Creates the thread-specific key for the rings.
+void create_ring_key()
+{
+    HASSERT(0 == pthread_key_create(&ringKey, &ring_thread_exit));
+}
+#endif
+
+/// Remembers the ring of the calling thread. @param r the ring. @return r.
+Ring *set_thread_ring(Ring *r)
+{
+#if OPENMRN_FEATURE_MUTEX_PTHREAD
+    pthread_setspecific(ringKey, r);
+#endif
+    return r;
+}
+
+/// @return the ring of the calling thread, allocating it on first use, or
+/// nullptr if all MAX_THREADS rings are taken.
+Ring *thread_ring()
+{
+    os_thread_t self = os_thread_self();
+#if OPENMRN_FEATURE_MUTEX_PTHREAD
+    pthread_once(&ringKeyOnce, &create_ring_key);
+    Ring *r = static_cast<Ring *>(pthread_getspecific(ringKey));
+    if (r)
+    {
+        return r;
+    }
+#else
+    unsigned n = numRings.load(std::memory_order_acquire);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        if (rings[i]->thread == self)
+        {
+            return rings[i];
+        }
+    }
+    Ring *r;
+#endif
+    // First use from this thread. Takes over the ring of an exited thread if
+    // there is one.
+    os_mutex_lock(&drainLock);
+    unsigned num = numRings.load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < num; ++i)
+    {
+        if (!rings[i]->inUse)
+        {
+            rings[i]->inUse = true;
+            rings[i]->thread = self;
+            os_mutex_unlock(&drainLock);
+            return set_thread_ring(rings[i]);
+        }
+    }
+    os_mutex_unlock(&drainLock);
+    if (num >= BinaryLog::MAX_THREADS)
+    {
+        return nullptr;
+    }
+    // Records are addressed with a mask, and the longest string argument
+    // still has to fit.
+    HASSERT((ring_size() & (ring_size() - 1)) == 0 && ring_size() >= 256);
+    r = new Ring;
+    r->data.reset(new uint64_t[ring_size() / 8]);
+    r->thread = self;
+    os_mutex_lock(&drainLock);
+    num = numRings.load(std::memory_order_relaxed);
+    if (num < BinaryLog::MAX_THREADS)
+    {
+        rings[num] = r;
+        numRings.store(num + 1, std::memory_order_release);
+        os_mutex_unlock(&drainLock);
+        return set_thread_ring(r);
+    }
+    os_mutex_unlock(&drainLock);
+    delete r;
+    return nullptr;
+}
+
+/// @return the byte at a wrapped offset of a ring.
+/// @param r ring
+/// @param ofs offset, not wrapped
+uint8_t *ring_ptr(Ring *r, uint32_t ofs)
+{
+    return reinterpret_cast<uint8_t *>(r->data.get()) +
+        (ofs & (ring_size() - 1));
+}
+
+} // namespace
+
+bool BinaryLog::begin_record(uint32_t size, Slot *s)
+{
+    Ring *r = thread_ring();
+    s->ring = r;
+    const uint32_t ring = ring_size();
+    if (!r || size > ring / 4)
+    {
+        s->ring = nullptr;
+        return false;
+    }
+    uint32_t head = r->head.load(std::memory_order_relaxed);
+    uint32_t tail = r->tail.load(std::memory_order_acquire);
+    uint32_t ofs = head & (ring - 1);
+    // Records are contiguous; the rest of the ring is skipped if the record
+    // does not fit before the end.
+    uint32_t pad = ofs + size > ring ? ring - ofs : 0;
+    if (ring - (head - tail) < pad + size)
+    {
+        r->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (pad >= HEADER_SIZE)
+    {
+        Header *h = reinterpret_cast<Header *>(ring_ptr(r, head));
+        h->fmt = nullptr;
+        h->size = pad;
+    }
+    s->data = ring_ptr(r, head + pad);
+    s->nextHead = head + pad + size;
+    return true;
+}
+
+void BinaryLog::commit_record(Slot *s)
+{
+    Ring *r = static_cast<Ring *>(s->ring);
+    reinterpret_cast<Header *>(s->data)->seq =
+        nextSeq.fetch_add(1, std::memory_order_relaxed);
+    r->head.store(s->nextHead, std::memory_order_release);
+}
+
+void BinaryLog::output_now(const uint8_t *rec)
+{
+    LOCK_LOG;
+    int len = render(rec, logbuffer, sizeof(logbuffer));
+    GLOBAL_LOG_OUTPUT(logbuffer, len);
+    UNLOCK_LOG;
+}
+
+unsigned BinaryLog::drain(void (*output)(char *buf, int size))
+{
+    if (!output)
+    {
+        output = &GLOBAL_LOG_OUTPUT;
+    }
+    os_mutex_lock(&drainLock);
+    unsigned count = drain_locked(output, true);
+    os_mutex_unlock(&drainLock);
+    return count;
+}
+
+unsigned BinaryLog::try_drain()
+{
+    if (os_mutex_trylock(&drainLock) != 0)
+    {
+        return 0;
+    }
+    unsigned count = 0;
+#ifdef LOCKED_LOGGING
+    if (os_mutex_trylock(&g_log_mutex) == 0)
+    {
+        count = drain_locked(&GLOBAL_LOG_OUTPUT, false);
+        os_mutex_unlock(&g_log_mutex);
+    }
+#else
+    count = drain_locked(&GLOBAL_LOG_OUTPUT, false);
+#endif
+    os_mutex_unlock(&drainLock);
+    return count;
+}
+
+unsigned BinaryLog::drain_locked(
+    void (*output)(char *buf, int size), bool lock_log)
+{
+    unsigned count = 0;
+    const uint32_t ring = ring_size();
+    unsigned n = numRings.load(std::memory_order_acquire);
+    // Snapshot of the write offsets. Records committed after this are left
+    // for the next call, so a busy logger cannot keep drain() running.
+    uint32_t heads[MAX_THREADS];
+    for (unsigned i = 0; i < n; ++i)
+    {
+        heads[i] = rings[i]->head.load(std::memory_order_acquire);
+    }
+    while (true)
+    {
+        // Finds the oldest pending record across all rings.
+        Ring *best = nullptr;
+        const Header *best_h = nullptr;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            Ring *r = rings[i];
+            uint32_t tail = r->tail.load(std::memory_order_relaxed);
+            const Header *h = nullptr;
+            while (tail != heads[i])
+            {
+                uint32_t left = ring - (tail & (ring - 1));
+                h = reinterpret_cast<const Header *>(ring_ptr(r, tail));
+                if (left < HEADER_SIZE || !h->fmt)
+                {
+                    // Padding at the end of the ring.
+                    tail += left;
+                    h = nullptr;
+                    continue;
+                }
+                break;
+            }
+            r->tail.store(tail, std::memory_order_release);
+            if (h && (!best_h || (int32_t)(h->seq - best_h->seq) < 0))
+            {
+                best = r;
+                best_h = h;
+            }
+        }
+        if (!best)
+        {
+            break;
+        }
+        if (lock_log)
+        {
+            LOCK_LOG;
+        }
+        int len = render(
+            reinterpret_cast<const uint8_t *>(best_h), logbuffer,
+            sizeof(logbuffer));
+        output(logbuffer, len);
+        if (lock_log)
+        {
+            UNLOCK_LOG;
+        }
+        ++count;
+        best->tail.store(best->tail.load(std::memory_order_relaxed) +
+                best_h->size,
+            std::memory_order_release);
+    }
+    unsigned drops = 0;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        drops += rings[i]->dropped.load(std::memory_order_relaxed);
+    }
+    if (drops != reportedDrops)
+    {
+        if (lock_log)
+        {
+            LOCK_LOG;
+        }
+        int len = snprintf(logbuffer, sizeof(logbuffer),
+            "BinaryLog: %u log lines dropped (ring full)",
+            drops - reportedDrops);
+        if (len >= (int)sizeof(logbuffer))
+        {
+            len = sizeof(logbuffer) - 1;
+        }
+        output(logbuffer, len);
+        if (lock_log)
+        {
+            UNLOCK_LOG;
+        }
+        reportedDrops = drops;
+        ++count;
+    }
+    return count;
+}
+
+unsigned BinaryLog::dropped()
+{
+    unsigned drops = 0;
+    unsigned n = numRings.load(std::memory_order_acquire);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        drops += rings[i]->dropped.load(std::memory_order_relaxed);
+    }
+    return drops;
+}
+
+int BinaryLog::render(const uint8_t *rec, char *buf, int size)
+{
+    const Header *h = reinterpret_cast<const Header *>(rec);
+    const uint8_t *arg = rec + HEADER_SIZE;
+    const uint8_t *end = rec + h->size;
+    const char *f = h->fmt;
+    int len = 0;
+
+    // Fetches the next argument. Returns false if there are no more.
+    const ArgHeader *ah = nullptr;
+    uint64_t value = 0;
+    auto next_arg = [&]() {
+        if (arg + ARG_SIZE > end)
+        {
+            return false;
+        }
+        ah = reinterpret_cast<const ArgHeader *>(arg);
+        memcpy(&value, arg + sizeof(ArgHeader), sizeof(value));
+        arg += ARG_SIZE;
+        if (ah->kind == ARG_STRING)
+        {
+            arg += (ah->length + 1 + 7) & ~7u;
+        }
+        return true;
+    };
+    // Interprets the current argument as an integer of its original size.
+    auto as_signed = [&]() -> long long {
+        if (ah->kind == ARG_DOUBLE)
+        {
+            double d;
+            memcpy(&d, &value, sizeof(d));
+            return (long long)d;
+        }
+        uint64_t v = value;
+        if (ah->size < 8)
+        {
+            unsigned bits = ah->size * 8;
+            uint64_t mask = (UINT64_C(1) << bits) - 1;
+            v &= mask;
+            if (v & (UINT64_C(1) << (bits - 1)))
+            {
+                v |= ~mask;
+            }
+        }
+        return (long long)v;
+    };
+    auto as_unsigned = [&]() -> unsigned long long {
+        uint64_t v = as_signed();
+        if (ah->size < 8)
+        {
+            v &= (UINT64_C(1) << (ah->size * 8)) - 1;
+        }
+        return v;
+    };
+    auto as_double = [&]() -> double {
+        if (ah->kind == ARG_DOUBLE)
+        {
+            double d;
+            memcpy(&d, &value, sizeof(d));
+            return d;
+        }
+        if (ah->kind == ARG_UNSIGNED)
+        {
+            return (double)as_unsigned();
+        }
+        return (double)as_signed();
+    };
+    // Appends the output of one snprintf call.
+    auto append = [&](int ret) {
+        if (ret > 0)
+        {
+            len += ret;
+            if (len > size - 1)
+            {
+                len = size - 1;
+            }
+        }
+    };
+
+    while (*f && len < size - 1)
+    {
+        if (*f != '%')
+        {
+            buf[len++] = *f++;
+            continue;
+        }
+        const char *start = f++;
+        if (*f == '%')
+        {
+            buf[len++] = '%';
+            ++f;
+            continue;
+        }
+        // Rebuilds the conversion specification with the length modifier
+        // matching how the argument was stored.
+        char spec[64];
+        unsigned sl = 0;
+        spec[sl++] = '%';
+        bool missing = false;
+        while (*f && strchr("-+ #0", *f) && sl < 8)
+        {
+            spec[sl++] = *f++;
+        }
+        for (int part = 0; part < 2; ++part)
+        {
+            if (part == 1)
+            {
+                if (*f != '.')
+                {
+                    break;
+                }
+                spec[sl++] = *f++;
+            }
+            if (*f == '*')
+            {
+                ++f;
+                if (next_arg())
+                {
+                    sl += snprintf(spec + sl, 12, "%d", (int)as_signed());
+                }
+                else
+                {
+                    missing = true;
+                }
+            }
+            else
+            {
+                while (*f >= '0' && *f <= '9' && sl < 40)
+                {
+                    spec[sl++] = *f++;
+                }
+            }
+        }
+        while (*f && strchr("hlLqjzt", *f))
+        {
+            ++f;
+        }
+        char conv = *f;
+        if (!conv)
+        {
+            break;
+        }
+        ++f;
+        if (missing || !next_arg())
+        {
+            // Not enough arguments: prints the specification as is.
+            append(snprintf(buf + len, size - len, "%.*s", (int)(f - start),
+                start));
+            continue;
+        }
+        switch (conv)
+        {
+            case 'd':
+            case 'i':
+                spec[sl++] = 'l';
+                spec[sl++] = 'l';
+                spec[sl++] = conv;
+                spec[sl] = 0;
+                append(snprintf(buf + len, size - len, spec, as_signed()));
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                spec[sl++] = 'l';
+                spec[sl++] = 'l';
+                spec[sl++] = conv;
+                spec[sl] = 0;
+                append(snprintf(buf + len, size - len, spec, as_unsigned()));
+                break;
+            case 'c':
+                spec[sl++] = conv;
+                spec[sl] = 0;
+                append(snprintf(buf + len, size - len, spec, (int)as_signed()));
+                break;
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                spec[sl++] = conv;
+                spec[sl] = 0;
+                append(snprintf(buf + len, size - len, spec, as_double()));
+                break;
+            case 's':
+            {
+                spec[sl++] = 's';
+                spec[sl] = 0;
+                const char *str = "(null)";
+                if (ah->kind == ARG_STRING)
+                {
+                    str = reinterpret_cast<const char *>(ah) + ARG_SIZE;
+                }
+                else if (value)
+                {
+                    str = "(?)";
+                }
+                append(snprintf(buf + len, size - len, spec, str));
+                break;
+            }
+            case 'p':
+            {
+                spec[sl++] = 'p';
+                spec[sl] = 0;
+                const void *p;
+                memcpy(&p, &value, sizeof(p));
+                append(snprintf(buf + len, size - len, spec, p));
+                break;
+            }
+            default:
+                // %n and unknown conversions are skipped.
+                break;
+        }
+    }
+    buf[len] = 0;
+    return len;
+}
@@ -0,0 +1,351 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file BinaryLog.hxx
+ *
+ * Deferred logging: log lines are stored in binary form (format string
+ * pointer and raw arguments) and rendered to text later.
+ *
+ * @author agent
+ * @date 17 Oct 2026
+ */
+
+#ifndef _UTILS_BINARYLOG_HXX_
+#define _UTILS_BINARYLOG_HXX_
+
+#include <stdint.h>
+#include <string.h>
+#include <memory>
+#include <type_traits>
+
+/// Deferred ("binary") logging backend. When DEFERRED_LOGGING is defined, the
+/// LOG() macro in C++ code calls record() instead of formatting the line under
+/// the log mutex. record() copies the format string pointer and the raw
+/// arguments into a ring buffer owned by the calling thread, without taking
+/// any lock. drain() (called periodically from BinaryLogFlow, or by hand)
+/// renders the pending lines in the order they were logged and passes them to
+/// log_output().
+///
+/// The format string must outlive the record, which is true for the string
+/// literals LOG() is used with. Non-literal formats and threads beyond
+/// MAX_THREADS are rendered synchronously. String (char *) arguments are
+/// copied into the record, truncated to MAX_STRING bytes. When a ring is
+/// full, new lines from that thread are dropped and counted.
+///
+/// Each ring takes config_binary_log_ring_size() bytes (64 KiB by default on
+/// hosts, 2 KiB on FreeRTOS) and is never freed. With pthreads, the ring of
+/// an exited thread is handed to the next new thread that logs; its pending
+/// lines are still drained in order. Thus MAX_THREADS limits the threads
+/// logging at the same time, and the memory use stays below MAX_THREADS times
+/// the ring size. Without pthreads a ring belongs to its thread forever, so
+/// only the first MAX_THREADS threads get one.
+class BinaryLog
+{
+public:
+    /// Number of threads that can have their own ring buffer at the same
+    /// time.
+    static constexpr unsigned MAX_THREADS = 32;
+    /// String arguments are truncated to this many bytes.
+    static constexpr unsigned MAX_STRING = 255;
+
+    /// Records a log line for deferred rendering.
+    /// @param fmt printf format string. If this is a string literal (an
+    /// array), only its pointer is stored. Other formats are rendered right
+    /// away, because they may not be around anymore when the ring is drained.
+    /// @param args arguments referenced from the format string.
+    template <typename F, typename... Args>
+    static void record(const F &fmt, Args... args)
+    {
+        uint32_t size = HEADER_SIZE + args_size(args...);
+        Slot s {nullptr, nullptr, 0};
+        if (!std::is_array<F>::value)
+        {
+            record_now(fmt, size, args...);
+        }
+        else if (begin_record(size, &s))
+        {
+            encode(s.data, fmt, size, args...);
+            commit_record(&s);
+        }
+        else if (!s.ring)
+        {
+            record_now(fmt, size, args...);
+        }
+    }
+
+    /// Renders all pending log lines in the order they were recorded and
+    /// writes them to the log output. May be called from any thread; calls
+    /// are serialized.
+    /// @param output is called with each rendered line, in the same way as
+    /// log_output(). nullptr means log_output().
+    /// @return the number of lines written.
+    static unsigned drain(void (*output)(char *buf, int size) = nullptr);
+
+    /// Like drain() to log_output(), but does nothing if the locks it needs
+    /// are taken. Used before the process dies from LOG(FATAL), which may
+    /// happen while the calling thread holds one of these locks.
+    /// @return the number of lines written.
+    static unsigned try_drain();
+
+    /// @return the total number of log lines dropped because a ring buffer
+    /// was full.
+    static unsigned dropped();
+
+private:
+    /// Stored at the beginning of every record.
+    struct Header
+    {
+        /// Format string. nullptr for padding at the end of the ring.
+        const char *fmt;
+        /// Total size of the record in bytes, including this header.
+        uint32_t size;
+        /// Global sequence number, used to merge the per-thread rings.
+        uint32_t seq;
+    };
+
+    /// Size reserved for the Header; keeps the arguments 8-byte aligned.
+    static constexpr uint32_t HEADER_SIZE = (sizeof(Header) + 7) & ~7u;
+
+    /// Type of an encoded argument.
+    enum ArgKind : uint8_t
+    {
+        ARG_SIGNED,
+        ARG_UNSIGNED,
+        ARG_DOUBLE,
+        ARG_POINTER,
+        /// char pointer; the string contents follow the value.
+        ARG_STRING,
+    };
+
+    /// Stored in front of every argument. Followed by 8 bytes of value, then
+    /// for strings by the contents with a terminating zero, padded to 8.
+    struct ArgHeader
+    {
+        /// What type of value follows.
+        ArgKind kind;
+        /// For integers the size of the argument after default promotion.
+        uint8_t size;
+        /// For strings the number of bytes stored (without the zero).
+        uint16_t length;
+        /// Unused.
+        uint32_t reserved;
+    };
+
+    /// Bytes taken by an argument without string contents.
+    static constexpr uint32_t ARG_SIZE = sizeof(ArgHeader) + 8;
+
+    /// A reserved area in a ring buffer.
+    struct Slot
+    {
+        /// Ring of the calling thread, nullptr if it has none.
+        void *ring;
+        /// Where the record should be written.
+        uint8_t *data;
+        /// Value of the write offset after the record is committed.
+        uint32_t nextHead;
+    };
+
+    /// Reserves space for a record in the calling thread's ring.
+    /// @param size bytes to reserve.
+    /// @param s filled in with the reserved area.
+    /// @return true on success. On failure s->ring tells whether the ring was
+    /// full (non-null) or the thread has no ring (null).
+    static bool begin_record(uint32_t size, Slot *s);
+
+    /// Makes a record written to a Slot visible to drain().
+    static void commit_record(Slot *s);
+
+    /// Implementation of drain(). The caller holds drainLock.
+    /// @param output is called with each rendered line.
+    /// @param lock_log true if the log lock has to be taken around each line
+    /// (false if the caller holds it).
+    /// @return the number of lines written.
+    static unsigned drain_locked(
+        void (*output)(char *buf, int size), bool lock_log);
+
+    /// Renders an encoded record and writes it to the log output.
+    static void output_now(const uint8_t *rec);
+
+    /// Encodes a record into a temporary buffer and outputs it right away.
+    template <typename... Args>
+    static void record_now(const char *fmt, uint32_t size, Args... args)
+    {
+        std::unique_ptr<uint64_t[]> buf(new uint64_t[(size + 7) / 8]);
+        uint8_t *p = reinterpret_cast<uint8_t *>(buf.get());
+        encode(p, fmt, size, args...);
+        output_now(p);
+    }
+
+    /// Writes a complete record.
+    template <typename... Args>
+    static void encode(uint8_t *p, const char *fmt, uint32_t size, Args... args)
+    {
+        Header *h = reinterpret_cast<Header *>(p);
+        h->fmt = fmt;
+        h->size = size;
+        h->seq = 0;
+        put_args(p + HEADER_SIZE, args...);
+    }
+
+    /// @return the number of bytes needed to store a string argument.
+    static uint32_t string_size(const char *s)
+    {
+        size_t len = s ? strnlen(s, MAX_STRING) : 0;
+        return ARG_SIZE + ((len + 1 + 7) & ~7u);
+    }
+
+    /// @return bytes needed to store an argument.
+    static uint32_t arg_size(const char *s)
+    {
+        return string_size(s);
+    }
+
+    /// @return bytes needed to store an argument.
+    static uint32_t arg_size(char *s)
+    {
+        return string_size(s);
+    }
+
+    /// @return bytes needed to store an argument.
+    template <typename T> static uint32_t arg_size(T)
+    {
+        return ARG_SIZE;
+    }
+
+    /// Terminates the recursion.
+    static uint32_t args_size()
+    {
+        return 0;
+    }
+
+    /// @return bytes needed to store all arguments.
+    template <typename T, typename... Rest>
+    static uint32_t args_size(T v, Rest... rest)
+    {
+        return arg_size(v) + args_size(rest...);
+    }
+
+    /// Terminates the recursion.
+    static void put_args(uint8_t *)
+    {
+    }
+
+    /// Encodes all arguments starting at p.
+    template <typename T, typename... Rest>
+    static void put_args(uint8_t *p, T v, Rest... rest)
+    {
+        p = put_arg(p, v);
+        put_args(p, rest...);
+    }
+
+    /// Writes the argument header and value.
+    /// @return pointer after the value.
+    template <typename V>
+    static uint8_t *put_value(uint8_t *p, ArgKind kind, uint8_t size, V v)
+    {
+        ArgHeader *h = reinterpret_cast<ArgHeader *>(p);
+        h->kind = kind;
+        h->size = size;
+        h->length = 0;
+        h->reserved = 0;
+        uint64_t raw = 0;
+        memcpy(&raw, &v, sizeof(v));
+        memcpy(p + sizeof(ArgHeader), &raw, sizeof(raw));
+        return p + ARG_SIZE;
+    }
+
+    /// Encodes an integer or enum argument.
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value ||
+            std::is_enum<T>::value,
+        uint8_t *>::type
+    put_arg(uint8_t *p, T v)
+    {
+        // Varargs promote everything smaller than int.
+        constexpr uint8_t size = sizeof(T) < sizeof(int) ? sizeof(int)
+                                                         : sizeof(T);
+        if (std::is_signed<typename std::conditional<std::is_enum<T>::value,
+                int, T>::type>::value)
+        {
+            return put_value(p, ARG_SIGNED, size, (int64_t)v);
+        }
+        return put_value(p, ARG_UNSIGNED, size, (uint64_t)v);
+    }
+
+    /// Encodes a floating point argument.
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value,
+        uint8_t *>::type
+    put_arg(uint8_t *p, T v)
+    {
+        return put_value(p, ARG_DOUBLE, sizeof(double), (double)v);
+    }
+
+    /// Encodes a pointer argument.
+    template <typename T> static uint8_t *put_arg(uint8_t *p, T *v)
+    {
+        return put_value(p, ARG_POINTER, sizeof(v), (const void *)v);
+    }
+
+    /// Encodes a null pointer argument.
+    static uint8_t *put_arg(uint8_t *p, std::nullptr_t)
+    {
+        return put_value(p, ARG_POINTER, sizeof(void *), (const void *)0);
+    }
+
+    /// Encodes a string argument by copying its contents.
+    static uint8_t *put_arg(uint8_t *p, const char *s)
+    {
+        if (!s)
+        {
+            return put_value(p, ARG_POINTER, sizeof(s), (const void *)s);
+        }
+        size_t len = strnlen(s, MAX_STRING);
+        uint8_t *d = put_value(p, ARG_STRING, sizeof(s), (const void *)s);
+        reinterpret_cast<ArgHeader *>(p)->length = len;
+        memcpy(d, s, len);
+        d[len] = 0;
+        return d + ((len + 1 + 7) & ~7u);
+    }
+
+    /// Encodes a string argument by copying its contents.
+    static uint8_t *put_arg(uint8_t *p, char *s)
+    {
+        return put_arg(p, (const char *)s);
+    }
+
+    /// Renders a record into a text buffer.
+    /// @param rec the encoded record.
+    /// @param buf output buffer.
+    /// @param size size of buf, must be positive.
+    /// @return the number of characters written to buf (without the
+    /// terminating zero, which is always written).
+    static int render(const uint8_t *rec, char *buf, int size);
+
+    friend class BinaryLogTest;
+};
+
+#endif // _UTILS_BINARYLOG_HXX_
@@ -0,0 +1,83 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file BinaryLogFlow.hxx
+ *
+ * Periodically writes out the deferred log lines.
+ *
+ * @author agent
+ * @date 17 Oct 2026
+ */
+
+#ifndef _UTILS_BINARYLOGFLOW_HXX_
+#define _UTILS_BINARYLOGFLOW_HXX_
+
+#include "executor/StateFlow.hxx"
+#include "utils/BinaryLog.hxx"
+
+/// This stateflow renders the log lines stored by BinaryLog (when the
+/// application is compiled with DEFERRED_LOGGING) and writes them to the log
+/// output every few msec. Put it on an executor that is not on the hot path,
+/// since rendering is what the deferred logging took off the logging threads.
+class BinaryLogFlow : public StateFlowBase
+{
+public:
+    /// Constructor.
+    /// @param service defines which executor to run on.
+    /// @param period_nsec how often to drain the log buffers.
+    /// @param output is called with each rendered line, nullptr means
+    /// log_output().
+    BinaryLogFlow(Service *service, long long period_nsec = MSEC_TO_NSEC(20),
+        void (*output)(char *buf, int size) = nullptr)
+        : StateFlowBase(service)
+        , periodNsec_(period_nsec)
+        , output_(output)
+    {
+        start_flow(STATE(wait_period));
+    }
+
+private:
+    /// Sleeps until the next drain.
+    Action wait_period()
+    {
+        return sleep_and_call(&timer_, periodNsec_, STATE(drain));
+    }
+
+    /// Writes out the pending log lines.
+    Action drain()
+    {
+        BinaryLog::drain(output_);
+        return call_immediately(STATE(wait_period));
+    }
+
+    StateFlowTimer timer_ {this};
+    /// How often to drain the log buffers.
+    long long periodNsec_;
+    /// Where to write the log lines; nullptr for log_output().
+    void (*output_)(char *buf, int size);
+};
+
+#endif // _UTILS_BINARYLOGFLOW_HXX_
@@ -32,7 +32,10 @@
  */
 
 #include "utils/Buffer.hxx"
+
+#include "openmrn_features.h"
 #include "utils/ByteBuffer.hxx"
+#include "utils/SimpleQueue.hxx"
 
 DynamicPool *mainBufferPool = nullptr;
 Pool *rawBufferPool = nullptr;
@@ -45,8 +48,13 @@ Pool* init_main_buffer_pool()
     }
     if (!mainBufferPool)
     {
+#ifdef OPENMRN_FEATURE_BUFFER_THREAD_CACHE
+        mainBufferPool = new ThreadCachedPool(
+            Bucket::init(32, 48, LARGEST_BUFFERPOOL_BUCKET, 0));
+#else
         mainBufferPool =
             new DynamicPool(Bucket::init(32, 48, LARGEST_BUFFERPOOL_BUCKET, 0));
+#endif
     }
     return mainBufferPool;
 }
@@ -186,6 +194,322 @@ void DynamicPool::free(BufferBase *item)
     free_large(item);
 }
 
+/// Free lists of one thread in a ThreadCachedPool.
+struct ThreadCachedPool::ThreadCache
+{
+    /// Free list of one bucket. Only the owning thread modifies the values;
+    /// the counters are atomic so that other threads can read statistics.
+    struct Entry
+    {
+        /// Free buffers.
+        SimpleQueue items;
+        /// Number of buffers in items.
+        std::atomic<unsigned> count {0};
+        /// Allocations served from items.
+        std::atomic<unsigned> hits {0};
+        /// Allocations that found items empty.
+        std::atomic<unsigned> misses {0};
+    };
+
+    /// An Entry padded to a cache line, so that threads do not slow each
+    /// other down by writing to the same cache line.
+    struct PaddedEntry : public Entry
+    {
+        /// Unused.
+        char pad_[64 - sizeof(Entry)];
+    };
+
+    /// Constructor. Marks the free lists as used by the current thread.
+    /// @param p the pool owning the free lists.
+    /// @param num_buckets how many buckets the pool has.
+    ThreadCache(ThreadCachedPool *p, unsigned num_buckets)
+        : pool(p)
+        , thread(os_thread_self())
+        , entries_(new PaddedEntry[num_buckets + 2])
+    {
+    }
+
+    /// @param index bucket index.
+    /// @return the free list of the bucket.
+    Entry &entry(unsigned index)
+    {
+        // The first and last entries keep other heap objects off the cache
+        // lines of the used ones.
+        return entries_[index + 1];
+    }
+
+    /// Pool owning these free lists.
+    ThreadCachedPool *pool;
+    /// Thread owning these free lists.
+    os_thread_t thread;
+    /// False if the owning thread exited. Protected by the pool lock.
+    bool inUse {true};
+
+private:
+    /// One entry per bucket, plus one padding entry at each end.
+    std::unique_ptr<PaddedEntry[]> entries_;
+};
+
+/// Adds to a counter that only one thread writes.
+/// @param v the counter.
+/// @param delta how much to add.
+static inline void add_relaxed(std::atomic<unsigned> &v, unsigned delta)
+{
+    v.store(v.load(std::memory_order_relaxed) + delta,
+        std::memory_order_relaxed);
+}
+
+ThreadCachedPool::ThreadCachedPool(Bucket sizes[], unsigned batch_size)
+    : DynamicPool(sizes)
+    , numBuckets_(0)
+    , batchSize_(batch_size)
+{
+    HASSERT(batch_size > 0);
+    while (buckets[numBuckets_].size() != 0)
+    {
+        ++numBuckets_;
+    }
+#if OPENMRN_FEATURE_MUTEX_PTHREAD
+    HASSERT(0 == pthread_key_create(&key_, &thread_exit));
+#endif
+}
+
+ThreadCachedPool::~ThreadCachedPool()
+{
+#if OPENMRN_FEATURE_MUTEX_PTHREAD
+    pthread_key_delete(key_);
+#endif
+    for (unsigned i = 0; i < numCaches_; ++i)
+    {
+        for (unsigned j = 0; j < numBuckets_; ++j)
+        {
+            return_to_bucket(caches_[i], j, caches_[i]->entry(j).count);
+        }
+        delete caches_[i];
+    }
+}
+
+unsigned ThreadCachedPool::bucket_index(size_t size)
+{
+    unsigned i = 0;
+    while (i < numBuckets_ && size > buckets[i].size())
+    {
+        ++i;
+    }
+    return i;
+}
+
+ThreadCachedPool::ThreadCache *ThreadCachedPool::thread_cache()
+{
+    os_thread_t self = os_thread_self();
+#if OPENMRN_FEATURE_MUTEX_PTHREAD
+    ThreadCache *c = static_cast<ThreadCache *>(pthread_getspecific(key_));
+    if (c)
+    {
+        return c;
+    }
+#else
+    unsigned n = numCaches_.load(std::memory_order_acquire);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        if (caches_[i]->thread == self)
+        {
+            return caches_[i];
+        }
+    }
+    ThreadCache *c;
+#endif
+    // First use from this thread. Takes over the free lists of an exited
+    // thread if there is one.
+    {
+        AtomicHolder h(this);
+        unsigned n = numCaches_.load(std::memory_order_relaxed);
+        for (unsigned i = 0; i < n; ++i)
+        {
+            if (!caches_[i]->inUse)
+            {
+                caches_[i]->inUse = true;
+                caches_[i]->thread = self;
+                return set_thread_cache(caches_[i]);
+            }
+        }
+        if (n >= MAX_THREADS)
+        {
+            return nullptr;
+        }
+    }
+    c = new ThreadCache(this, numBuckets_);
+    {
+        AtomicHolder h(this);
+        unsigned n = numCaches_.load(std::memory_order_relaxed);
+        if (n < MAX_THREADS)
+        {
+            caches_[n] = c;
+            numCaches_.store(n + 1, std::memory_order_release);
+            return set_thread_cache(c);
+        }
+    }
+    delete c;
+    return nullptr;
+}
+
+ThreadCachedPool::ThreadCache *ThreadCachedPool::set_thread_cache(
+    ThreadCache *c)
+{
+#if OPENMRN_FEATURE_MUTEX_PTHREAD
+    pthread_setspecific(key_, c);
+#endif
+    return c;
+}
+
+#if OPENMRN_FEATURE_MUTEX_PTHREAD
+void ThreadCachedPool::thread_exit(void *cache)
+{
+    ThreadCache *c = static_cast<ThreadCache *>(cache);
+    ThreadCachedPool *pool = c->pool;
+    for (unsigned j = 0; j < pool->numBuckets_; ++j)
+    {
+        pool->return_to_bucket(c, j, c->entry(j).count);
+    }
+    AtomicHolder h(pool);
+    c->inUse = false;
+}
+#endif
+
+void ThreadCachedPool::return_to_bucket(
+    ThreadCache *c, unsigned index, unsigned count)
+{
+    ThreadCache::Entry &e = c->entry(index);
+    Bucket *b = buckets + index;
+    unsigned moved = 0;
+    {
+        AtomicHolder h(b->lock());
+        for (; moved < count && !e.items.empty(); ++moved)
+        {
+            b->insert_locked(e.items.pop_front());
+        }
+    }
+    add_relaxed(e.count, -moved);
+}
+
+BufferBase *ThreadCachedPool::alloc_untyped(size_t size, Executable *flow)
+{
+    unsigned index = bucket_index(size);
+    ThreadCache *c;
+    if (index >= numBuckets_ || (c = thread_cache()) == nullptr)
+    {
+        return DynamicPool::alloc_untyped(size, flow);
+    }
+    ThreadCache::Entry &e = c->entry(index);
+    if (e.items.empty())
+    {
+        add_relaxed(e.misses, 1);
+        // Refills the free list with a batch from the shared bucket.
+        Bucket *b = buckets + index;
+        unsigned moved = 0;
+        {
+            AtomicHolder h(b->lock());
+            for (; moved < batchSize_; ++moved)
+            {
+                QMember *m = b->next_locked().item;
+                if (!m)
+                {
+                    break;
+                }
+                e.items.push_front(m);
+            }
+        }
+        if (!moved)
+        {
+            // Nothing in the shared bucket either; goes to the heap.
+            return DynamicPool::alloc_untyped(size, flow);
+        }
+        add_relaxed(e.count, moved);
+    }
+    else
+    {
+        add_relaxed(e.hits, 1);
+    }
+    BufferBase *result = static_cast<BufferBase *>(e.items.pop_front());
+    add_relaxed(e.count, -1);
+    new (result) BufferBase(size, this);
+    if (flow)
+    {
+        flow->alloc_result(result);
+    }
+    return result;
+}
+
+void ThreadCachedPool::free(BufferBase *item)
+{
+    unsigned index = bucket_index(item->size());
+    ThreadCache *c;
+    if (index >= numBuckets_ || (c = thread_cache()) == nullptr)
+    {
+        DynamicPool::free(item);
+        return;
+    }
+    ThreadCache::Entry &e = c->entry(index);
+    e.items.push_front(item);
+    add_relaxed(e.count, 1);
+    if (e.count.load(std::memory_order_relaxed) > 2 * batchSize_)
+    {
+        return_to_bucket(c, index, batchSize_);
+    }
+}
+
+size_t ThreadCachedPool::free_items()
+{
+    size_t total = DynamicPool::free_items();
+    unsigned n = numCaches_.load(std::memory_order_acquire);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        for (unsigned j = 0; j < numBuckets_; ++j)
+        {
+            total += caches_[i]->entry(j).count.load();
+        }
+    }
+    return total;
+}
+
+size_t ThreadCachedPool::free_items(size_t size)
+{
+    size_t total = DynamicPool::free_items(size);
+    unsigned index = bucket_index(size);
+    if (index >= numBuckets_)
+    {
+        return total;
+    }
+    unsigned n = numCaches_.load(std::memory_order_acquire);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        total += caches_[i]->entry(index).count.load();
+    }
+    return total;
+}
+
+bool ThreadCachedPool::get_stats(unsigned index, BucketStats *stats)
+{
+    if (index >= numBuckets_)
+    {
+        return false;
+    }
+    stats->size = buckets[index].size();
+    stats->highWater = buckets[index].allocCount_;
+    stats->free = buckets[index].pending();
+    stats->hits = 0;
+    stats->misses = 0;
+    unsigned n = numCaches_.load(std::memory_order_acquire);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        ThreadCache::Entry &e = caches_[i]->entry(index);
+        stats->free += e.count.load();
+        stats->hits += e.hits.load();
+        stats->misses += e.misses.load();
+    }
+    return true;
+}
+
 /** Get a free item out of the pool.
  * @param size how many payload bytes should he allocated buffer have. Usually
  * sizeof<T> for Buffer<T>.
@@ -54,6 +54,7 @@
 #include "utils/macros.h"
 
 class DynamicPool;
+class ThreadCachedPool;
 class FixedPool;
 class LimitedPool;
 class Pool;
@@ -177,6 +178,9 @@ protected:
     /** Allow DynamicPool access to our constructor */
     friend class DynamicPool;
 
+    /** Allow ThreadCachedPool access to our constructor */
+    friend class ThreadCachedPool;
+
     /** Allow FixedPool access to our constructor */
     friend class FixedPool;
 
@@ -487,7 +491,7 @@ private:
 /** A specialization of a pool which can allocate new elements dynamically
  * upon request.
  */
-class DynamicPool : public Pool, private Atomic
+class DynamicPool : public Pool, protected Atomic
 {
 public:
     /** Constructor.
@@ -535,7 +539,6 @@ protected:
     /** Free buffer queue */
     Bucket *buckets;
 
-private:
     /** Get a free item out of the pool.
      * @param result pointer to a pointer to the result
      * @param flow if !NULL, then the alloc call is considered async and will
@@ -545,6 +548,13 @@ private:
      */
     BufferBase *alloc_untyped(size_t size, Executable *flow) override;
 
+    /** Releases an item back to the free pool.
+     * @param item pointer to item to release
+     */
+    void free(BufferBase *item) override;
+
+private:
+
     /** Allocates a large memory block directly from the heap. @param size is
      * the block size to allocate from the heap. @return the allocated
      * block. */
@@ -553,11 +563,6 @@ private:
      * the memory block to free. */
     void free_large(void* block);
 
-    /** Releases an item back to the free pool.
-     * @param item pointer to item to release
-     */
-    void free(BufferBase *item) override;
-
     /** Default constructor.
      */
     DynamicPool();
@@ -567,6 +572,121 @@ private:
     DISALLOW_COPY_AND_ASSIGN(DynamicPool);
 };
 
+/** A DynamicPool that keeps a private free list of every bucket size for
+ * each thread (and thus each executor) allocating from it. Allocations and
+ * frees on the thread's own free lists take no lock. An empty free list is
+ * refilled with a batch of buffers from the shared buckets, and a free list
+ * that grew beyond two batches returns a batch to the shared buckets, each
+ * under a single lock. Up to MAX_THREADS threads get a free list; further
+ * threads, and buffers larger than the largest bucket, use the DynamicPool
+ * directly. With pthreads, a thread's free lists are flushed to the shared
+ * buckets when the thread exits, and its slot is given to the next thread.
+ * Elsewhere slots are never released, so the pool should only be used with
+ * long-lived threads (executors).
+ */
+class ThreadCachedPool : public DynamicPool
+{
+public:
+    /** Constructor.
+     * @param sizes array of bucket sizes for the pool
+     * @param batch_size how many buffers to move between the shared buckets
+     * and the free list of a thread at a time.
+     */
+    ThreadCachedPool(Bucket sizes[], unsigned batch_size = 8);
+
+    /** Destructor. Must not be called while other threads use the pool. */
+    ~ThreadCachedPool();
+
+    /** Number of free items in the pool.
+     * @return number of free items in the pool
+     */
+    size_t free_items() override;
+
+    /** Number of free items in the pool for a given allocation size.
+     * @param size size of interest
+     * @return number of free items in the pool for a given allocation size
+     */
+    size_t free_items(size_t size) override;
+
+    /// Statistics of one bucket. The values are read without locking, so they
+    /// may be slightly off while other threads are allocating.
+    struct BucketStats
+    {
+        /// Size of the buffers in this bucket.
+        size_t size;
+        /// Number of buffers ever allocated from the heap for this bucket,
+        /// i.e., the high-water mark of the buffers in use at the same time.
+        size_t highWater;
+        /// Number of free buffers in the shared bucket and all thread free
+        /// lists.
+        size_t free;
+        /// Number of allocations served from a thread free list.
+        unsigned hits;
+        /// Number of allocations that found the thread free list empty.
+        unsigned misses;
+    };
+
+    /** Fills in the statistics of a bucket.
+     * @param index which bucket, 0 is the smallest.
+     * @param stats will be filled in.
+     * @return false if there is no bucket with this index.
+     */
+    bool get_stats(unsigned index, BucketStats *stats);
+
+    /// How many threads get their own free lists at the same time.
+    static constexpr unsigned MAX_THREADS = 16;
+
+private:
+    struct ThreadCache;
+
+#if OPENMRN_FEATURE_MUTEX_PTHREAD
+    /** Called by pthreads when a thread that used the pool exits. Returns
+     * the thread's free lists to the shared buckets and releases its slot.
+     * @param cache the ThreadCache of the exiting thread. */
+    static void thread_exit(void *cache);
+#endif
+
+    BufferBase *alloc_untyped(size_t size, Executable *flow) override;
+    void free(BufferBase *item) override;
+
+    /** @return the free lists of the current thread, allocating them on
+     * first use, or nullptr if all MAX_THREADS slots are taken. */
+    ThreadCache *thread_cache();
+
+    /** Remembers the free lists of the current thread. @param c the free
+     * lists. @return c. */
+    ThreadCache *set_thread_cache(ThreadCache *c);
+
+    /** @param size buffer size.
+     * @return index of the smallest bucket fitting size, or numBuckets_ if
+     * none. */
+    unsigned bucket_index(size_t size);
+
+    /** Moves buffers of a bucket from a thread free list to the shared
+     * bucket.
+     * @param c thread free lists.
+     * @param index bucket index.
+     * @param count how many buffers to move. */
+    void return_to_bucket(ThreadCache *c, unsigned index, unsigned count);
+
+    /// Number of buckets.
+    unsigned numBuckets_;
+    /// How many buffers to move to/from the shared buckets at a time.
+    unsigned batchSize_;
+    /// Number of valid entries in caches_.
+    std::atomic<unsigned> numCaches_ {0};
+    /// Free lists of the threads allocating from this pool. Entries are
+    /// never deleted before the pool, only given to a new thread once their
+    /// owner exited.
+    ThreadCache *caches_[MAX_THREADS];
+#if OPENMRN_FEATURE_MUTEX_PTHREAD
+    /// Thread-specific key holding the ThreadCache of the current thread.
+    pthread_key_t key_;
+#endif
+
+    DISALLOW_COPY_AND_ASSIGN(ThreadCachedPool);
+};
+
 /** Pool of fixed number of items which can be allocated up on request.
  */
 class FixedPool : public Pool, public Atomic
@@ -79,6 +79,7 @@ public:
     DirectHubService(ExecutorBase *e)
         : Service(e)
         , busy_(0)
+        , admitterPending_(0)
     {
     }
 
@@ -140,12 +141,82 @@ public:
         executor()->add(static_cast<Executable *>(deq.item), deq.index);
     }
 
+    /// Holds back a caller whose source has used up its admission quantum. The
+    /// caller will be presented to enqueue_caller() after everything that is
+    /// already pending on the executor had a chance to run.
+    /// @param caller represents an entry point to the hub.
+    void hold_back_caller(Executable *caller)
+    {
+        {
+            AtomicHolder h(lock());
+            heldBack_.insert_locked(caller);
+            if (admitterPending_)
+            {
+                return;
+            }
+            admitterPending_ = 1;
+        }
+        executor()->add(&admitter_);
+    }
+
     /// 1 if there is any message being processed right now.
     unsigned busy_ : 1;
+    /// 1 if the admitter_ is scheduled on the executor.
+    unsigned admitterPending_ : 1;
     /// List of callers that are waiting for the busy_ lock.
     QueueType pendingSend_;
+    /// List of callers that were held back by the admission controller.
+    QueueType heldBack_;
+
+private:
+    /// Releases one held back caller every time it is executed. Re-schedules
+    /// itself to the end of the executor queue as long as there are more held
+    /// back callers, which gives round robin between the sources.
+    class Admitter : public Executable
+    {
+    public:
+        Admitter(DirectHubService *parent)
+            : parent_(parent)
+        {
+        }
+
+        void run() override
+        {
+            parent_->release_held_back();
+        }
+
+    private:
+        /// Owning service.
+        DirectHubService *parent_;
+    } admitter_ {this};
+
+    /// Takes the front of the held back queue and enqueues it for the hub.
+    void release_held_back()
+    {
+        Executable *caller;
+        bool more;
+        {
+            AtomicHolder h(lock());
+            caller = static_cast<Executable *>(heldBack_.next_locked().item);
+            more = !heldBack_.empty();
+            if (!more)
+            {
+                admitterPending_ = 0;
+            }
+        }
+        if (more)
+        {
+            executor()->add(&admitter_);
+        }
+        enqueue_caller(caller);
+    }
 };
 
+HubSourceAdmission::HubSourceAdmission()
+    : credit_(config_directhub_admission_quantum_bytes())
+{
+}
+
 template <class T>
 class DirectHubImpl : public DirectHubInterface<T>,
                       protected StateFlowBase,
@@ -204,6 +275,29 @@ public:
         service()->enqueue_caller(caller);
     }
 
+    void enqueue_send(
+        Executable *caller, HubSourceAdmission *source, size_t size) override
+    {
+        ++source->numAdmitted_;
+        int32_t quantum = config_directhub_admission_quantum_bytes();
+        // A message larger than the quantum is charged one full quantum, so
+        // that it costs exactly one round and the credit stays between zero
+        // and the quantum.
+        int32_t charge = std::min((int32_t)size, quantum);
+        if (source->credit_ < charge)
+        {
+            // The source used up its quantum. Refills the credit for the next
+            // round and lets the other sources go first. The held back
+            // message is paid for from the refill.
+            source->credit_ += quantum - charge;
+            ++source->numHeldBack_;
+            service()->hold_back_caller(caller);
+            return;
+        }
+        source->credit_ -= charge;
+        service()->enqueue_caller(caller);
+    }
+
     MessageAccessor<T> *mutable_message() override
     {
         return &msg_;
@@ -310,6 +404,12 @@ private:
             // flow. It will check fd_ < 0 to exit.
         }
 
+        /// @return the admission controller state of this source.
+        HubSourceAdmission *admission()
+        {
+            return &admission_;
+        }
+
     private:
         /// Root of the read flow. Starts with getting the barrier notifiable,
         /// either synchronously if one is available, or asynchronously.
@@ -448,7 +548,10 @@ private:
             wait_and_call(STATE(send_callback));
             inlineCall_ = 1;
             sendComplete_ = 0;
-            parent_->hub_->enqueue_send(this); // causes the callback
+            // causes the callback, possibly after the admission controller
+            // held us back. While held back we neither read the fd nor
+            // allocate buffers, which pushes back on the source.
+            parent_->hub_->enqueue_send(this, &admission_, segmentSize_);
             inlineCall_ = 0;
             if (sendComplete_)
             {
@@ -519,6 +622,8 @@ private:
         uint16_t inlineCall_ : 1;
         /// 1 if the run callback actually happened inline.
         uint16_t sendComplete_ : 1;
+        /// Admission controller state for this source.
+        HubSourceAdmission admission_;
         /// Pool of BarrierNotifiables that limit the amount of inflight bytes
         /// we have.
         AsyncNotifiableBlock pendingLimiterPool_ {
@@ -781,7 +886,9 @@ private:
     /// the shutdown() call. May delete this.
     void read_flow_exit()
     {
-        LOG(VERBOSE, "%p exit read", this);
+        LOG(VERBOSE, "%p exit read, %u packets admitted, %u held back", this,
+            (unsigned)readFlow_.admission()->num_admitted(),
+            (unsigned)readFlow_.admission()->num_held_back());
         flow_exit(true);
     }
 
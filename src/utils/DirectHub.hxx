@@ -47,6 +47,46 @@ class Service;
 class HubSource
 { };
 
+/// State of the admission controller for a single traffic source of a
+/// DirectHub. Each input port that wants to be subject to fair queueing owns
+/// one of these objects and passes it to every call of enqueue_send().
+///
+/// The admission controller implements deficit round robin: each source gets
+/// a quantum of config_directhub_admission_quantum_bytes() bytes. Once the
+/// quantum is used up, the next call from that source is held back until all
+/// other work already pending on the hub's executor had a chance to run
+/// (including sends from other sources), then the quantum is refilled.
+/// Messages larger than the quantum are charged as one quantum.
+class HubSourceAdmission
+{
+public:
+    HubSourceAdmission();
+
+    /// @return the number of messages that this source has sent to the hub.
+    uint32_t num_admitted()
+    {
+        return numAdmitted_;
+    }
+
+    /// @return the number of messages from this source that were held back by
+    /// the admission controller because the source used up its quantum.
+    uint32_t num_held_back()
+    {
+        return numHeldBack_;
+    }
+
+private:
+    template <class T> friend class DirectHubImpl;
+
+    /// How many bytes this source may still send before it has to yield to
+    /// the other sources (deficit counter).
+    int32_t credit_;
+    /// Number of messages admitted from this source.
+    uint32_t numAdmitted_ {0};
+    /// Number of messages that had to be held back.
+    uint32_t numHeldBack_ {0};
+};
+
 /// Metadata that is the same about every message (independent of data type).
 struct MessageMetadata
 {
@@ -189,6 +229,19 @@ public:
     /// to call do_send() inline.
     virtual void enqueue_send(Executable *caller) = 0;
 
+    /// Signals that the caller wants to send a message to the hub, going
+    /// through the admission controller of the given source. If the source
+    /// still has credit, this behaves like enqueue_send(caller). Otherwise the
+    /// caller is held back, and will be executed later on the hub's executor,
+    /// after the other sources had a chance to send. A source must not call
+    /// this again until the previous caller was executed.
+    /// @param caller callback that actually sends the message. It is required
+    /// to call do_send() inline.
+    /// @param source admission state of the traffic source.
+    /// @param size number of bytes in the message to be sent.
+    virtual void enqueue_send(
+        Executable *caller, HubSourceAdmission *source, size_t size) = 0;
+
     /// Accessor to fill in the message payload. Must be called only from
     /// within the callback as invoked by enqueue_send.
     /// @return mutable structure to fill in the message. This structure was
@@ -35,7 +35,9 @@
 #define _UTILS_HUB_HXX_
 
 #include <stdint.h>
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include "executor/Dispatcher.hxx"
 #include "can_frame.h"
@@ -145,6 +147,167 @@ typedef StateFlow<Buffer<CanHubData>, QList<1>> CanHubPort;
 /// This should work for both 32 and 64-bit architectures.
 static const uintptr_t POINTER_MASK = UINTPTR_MAX;
 
+/// Base class for a hub port that receives the messages by reference instead
+/// of by copy. When a hub forwards a message to such a port, it takes an
+/// additional reference to the same buffer instead of allocating a new buffer
+/// and copying the payload. The payload is thus shared by all such ports (and
+/// the sender), which means it is immutable: implementations must not modify
+/// message()->data().
+///
+/// Since the same buffer may be pending in the queue of several ports at the
+/// same time, the QMember link embedded in the buffer cannot be used. This
+/// class keeps its own ring of buffer pointers instead, which grows when more
+/// messages are pending than it has room for.
+///
+/// Implementations override entry() and return release_and_exit() when they
+/// are done with message(), just like with a StateFlow.
+template <class D>
+class SharedHubPort : public FlowInterface<Buffer<D>>,
+                      public StateFlowBase,
+                      private Atomic
+{
+public:
+    /// Constructor.
+    /// @param service defines which executor the port runs on.
+    /// @param queue_size is the initial number of pending messages the port
+    /// can hold before growing its queue. Will be rounded up to a power of
+    /// two.
+    SharedHubPort(Service *service, unsigned queue_size = 8)
+        : StateFlowBase(service)
+    {
+        unsigned sz = 1;
+        while (sz < queue_size)
+        {
+            sz <<= 1;
+        }
+        queue_.resize(sz);
+        wait_and_call(STATE(next_message));
+    }
+
+    /// Destructor. The port must have been unregistered from the hub already.
+    ~SharedHubPort()
+    {
+        while (count_)
+        {
+            queue_[head_]->unref();
+            head_ = (head_ + 1) & (queue_.size() - 1);
+            --count_;
+        }
+        if (current_)
+        {
+            current_->unref();
+        }
+    }
+
+    /// Enqueues a message to this port. The port takes ownership of one
+    /// reference of the buffer. @param msg is the buffer to process. @param
+    /// priority is ignored; messages are processed in FIFO order.
+    void send(Buffer<D> *msg, unsigned priority = UINT_MAX) override
+    {
+        // Storage for a larger ring. Allocated (and the old ring freed)
+        // outside of the lock.
+        std::vector<Buffer<D> *> q;
+        while (true)
+        {
+            size_t want;
+            {
+                AtomicHolder h(this);
+                if (count_ == queue_.size() && q.size() > queue_.size())
+                {
+                    grow_into(&q);
+                }
+                if (count_ < queue_.size())
+                {
+                    queue_[(head_ + count_) & (queue_.size() - 1)] = msg;
+                    ++count_;
+                    if (!isIdle_)
+                    {
+                        return;
+                    }
+                    isIdle_ = false;
+                    break;
+                }
+                want = queue_.size() * 2;
+            }
+            // Another thread may grow the ring in the meantime; that is
+            // checked again with the lock held.
+            q.resize(want);
+        }
+        this->notify();
+    }
+
+    /// @return true if the port has no pending messages and is not
+    /// processing one.
+    bool is_waiting()
+    {
+        AtomicHolder h(this);
+        return isIdle_ && !count_;
+    }
+
+protected:
+    /// Handler of the incoming messages. Called once for each message in
+    /// the queue. @return next action; eventually release_and_exit().
+    virtual Action entry() = 0;
+
+    /// @return the message being processed currently. The payload is shared
+    /// with other ports and must not be modified.
+    Buffer<D> *message()
+    {
+        return current_;
+    }
+
+    /// Releases the reference to the current message and proceeds to the
+    /// next one in the queue. @return next action.
+    Action release_and_exit()
+    {
+        current_->unref();
+        current_ = nullptr;
+        return call_immediately(STATE(next_message));
+    }
+
+private:
+    /// Dequeues the next message, or goes to sleep if there is none.
+    Action next_message()
+    {
+        {
+            AtomicHolder h(this);
+            if (!count_)
+            {
+                isIdle_ = true;
+                return wait_and_call(STATE(next_message));
+            }
+            current_ = queue_[head_];
+            head_ = (head_ + 1) & (queue_.size() - 1);
+            --count_;
+        }
+        return entry();
+    }
+
+    /// Moves the pending messages into a larger ring. Must be called with the
+    /// lock held. @param q is the new ring, its size a power of two larger
+    /// than the current one. On return it holds the old ring.
+    void grow_into(std::vector<Buffer<D> *> *q)
+    {
+        for (unsigned i = 0; i < count_; ++i)
+        {
+            (*q)[i] = queue_[(head_ + i) & (queue_.size() - 1)];
+        }
+        queue_.swap(*q);
+        head_ = 0;
+    }
+
+    /// Ring of pending messages. Size is always a power of two.
+    std::vector<Buffer<D> *> queue_;
+    /// Index of the oldest pending message in queue_.
+    unsigned head_ {0};
+    /// Number of pending messages in queue_.
+    unsigned count_ {0};
+    /// Message being processed by entry(), or nullptr.
+    Buffer<D> *current_ {nullptr};
+    /// True if the flow is not scheduled and is waiting for a message.
+    bool isIdle_ {true};
+};
+
 /// Templated implementation of the HubFlow.
 template<class D> class GenericHubFlow : public DispatchFlow<Buffer<D>, 1>
 {
@@ -155,6 +318,8 @@ public:
     typedef Buffer<value_type> buffer_type;
     /// Base type of an individual port.
     typedef FlowInterface<buffer_type> port_type;
+    /// Base type of a port that receives messages by reference.
+    typedef SharedHubPort<D> shared_port_type;
 
     /// Constructor. @param s defines which executor to run this on.
     GenericHubFlow(Service *s) : DispatchFlow<Buffer<D>, 1>(s)
@@ -176,6 +341,47 @@ public:
         this->unregister_handler(port, reinterpret_cast<uintptr_t>(port),
                                  POINTER_MASK);
     }
+
+    /// Adds a new port that receives the messages by reference. Such ports
+    /// do not cost a buffer allocation and copy per forwarded message. @param
+    /// port is the object to add.
+    virtual void register_shared_port(shared_port_type *port)
+    {
+        OSMutexLock h(&this->lock_);
+        sharedPorts_.push_back(port);
+    }
+
+    /// Removes a previously added shared port. @param port is the port to
+    /// remove.
+    virtual void unregister_shared_port(shared_port_type *port)
+    {
+        OSMutexLock h(&this->lock_);
+        sharedPorts_.erase(
+            std::remove(sharedPorts_.begin(), sharedPorts_.end(), port),
+            sharedPorts_.end());
+    }
+
+    /// Forwards the incoming message to the shared ports by reference, then
+    /// to the regular ports by copy. @return next action.
+    StateFlowBase::Action entry() override
+    {
+        port_type *skip = this->message()->data()->skipMember_;
+        {
+            OSMutexLock h(&this->lock_);
+            for (shared_port_type *p : sharedPorts_)
+            {
+                if (p != skip)
+                {
+                    p->send(this->message()->ref());
+                }
+            }
+        }
+        return DispatchFlow<Buffer<D>, 1>::entry();
+    }
+
+private:
+    /// Ports that receive the messages by reference.
+    std::vector<shared_port_type *> sharedPorts_;
 };
 
 /** A generic hub that proxies packets of untyped (aka string) data. */
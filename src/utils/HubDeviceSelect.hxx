@@ -312,7 +312,7 @@ public:
         barrier_.reset(
             on_error ? on_error : EmptyNotifiable::DefaultInstance());
         barrier_.new_child();
-        hub_->register_port(write_port());
+        hub_->register_shared_port(&writeFlow_);
         isRegistered_ = true;
     }
 #endif
@@ -325,7 +325,7 @@ public:
     /// @param on_error notifiable that will be called when a write or read
     /// error is encountered.
     HubDeviceSelect(HFlow *hub, int fd, Notifiable *on_error = nullptr)
-        : FdHubPortService(hub->service()->executor(), fd)
+        : FdHubPortService(hub->service()->executor(), set_nonblocking(fd))
         , hub_(hub)
         , readFlow_(this, hub, &writeFlow_)
         , writeFlow_(this)
@@ -334,13 +334,7 @@ public:
         barrier_.reset(
             on_error ? on_error : EmptyNotifiable::DefaultInstance());
         barrier_.new_child();
-#ifdef __WINNT__
-        unsigned long par = 1;
-        ioctlsocket(fd_, FIONBIO, &par);
-#else
-        ::fcntl(fd, F_SETFL, O_RDWR | O_NONBLOCK);
-#endif
-        hub_->register_port(write_port());
+        hub_->register_shared_port(&writeFlow_);
         isRegistered_ = true;
     }
 
@@ -392,11 +386,12 @@ public:
             }
             isRegistered_ = false;
         }
-        hub_->unregister_port(&writeFlow_);
+        hub_->unregister_shared_port(&writeFlow_);
         /* We put an empty message at the end of the queue. This will cause
          * wait until all pending messages are dealt with, and then ping the
          * barrier notifiable, commencing the shutdown. */
-        auto *b = writeFlow_.alloc();
+        typename HFlow::buffer_type *b;
+        mainBufferPool->alloc(&b);
         b->set_done(&barrier_);
         writeFlow_.send(b);
     }
@@ -409,8 +404,10 @@ public:
     }
 
 protected:
-    /// Base stateflow for the WriteFlow.
-    typedef StateFlow<typename HFlow::buffer_type, QList<1>> WriteFlowBase;
+    /// Base stateflow for the WriteFlow. The hub hands it the outgoing
+    /// messages by reference, so forwarding to a device does not cost a
+    /// buffer allocation and copy.
+    typedef typename HFlow::shared_port_type WriteFlowBase;
     /// State flow implementing select-aware fd writes.
     class WriteFlow : public WriteFlowBase
     {
@@ -456,8 +453,7 @@ protected:
             }
             return this->write_repeated(&selectHelper_, device()->fd(),
                 this->message()->data()->data(),
-                this->message()->data()->size(), STATE(write_done),
-                this->priority());
+                this->message()->data()->size(), STATE(write_done));
         }
 
         /// State flow call. @return next state.
@@ -494,6 +490,21 @@ protected:
         close_fd();
     }
 
+    /// Switches a file descriptor to non-blocking mode. This has to happen
+    /// before the read flow is started, because that may issue the first
+    /// read on the executor thread right away. @param fd is the file
+    /// descriptor. @return fd.
+    static int set_nonblocking(int fd)
+    {
+#ifdef __WINNT__
+        unsigned long par = 1;
+        ioctlsocket(fd, FIONBIO, &par);
+#else
+        ::fcntl(fd, F_SETFL, O_RDWR | O_NONBLOCK);
+#endif
+        return fd;
+    }
+
     void close_fd()
     {
         int fd = -1;
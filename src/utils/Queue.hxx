@@ -607,6 +607,177 @@ private:
  */
 template<unsigned items> using QListProtected = QList<items>;
 
+/** Lock-free multi-producer single-consumer queue of QMember items. This is an
+ * intrusive queue (after D. Vyukov) that uses the QMember link of the items,
+ * thus needs no memory allocation. Inserting takes one atomic exchange and
+ * never blocks; only a single thread is allowed to take items out.
+ *
+ * An item is only visible to the consumer once the producer completely
+ * finished linking it in. For a short time while a producer is in the middle
+ * of an insert, next() may return NULL even though empty() is false.
+ */
+class QMpsc
+{
+public:
+    /** Constructor. */
+    QMpsc()
+        : head_(&stub_)
+        , tail_(&stub_)
+    {
+        stub_.next = nullptr;
+    }
+
+    /** Add an item to the back of the queue. May be called from any thread.
+     * @param item to add to queue
+     */
+    void insert(QMember *item)
+    {
+        HASSERT(item->next == nullptr);
+        QMember *prev = __atomic_exchange_n(&head_, item, __ATOMIC_ACQ_REL);
+        __atomic_store_n(&prev->next, item, __ATOMIC_RELEASE);
+    }
+
+    /** Get an item from the front of the queue. Must be called only from
+     * the consumer thread.
+     * @return item retrieved from queue, NULL if no item available
+     */
+    QMember *next()
+    {
+        QMember *tail = tail_;
+        QMember *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+        if (tail == &stub_)
+        {
+            if (!next)
+            {
+                return nullptr;
+            }
+            set_tail(next);
+            tail = next;
+            next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+        }
+        if (!next)
+        {
+            if (tail != __atomic_load_n(&head_, __ATOMIC_ACQUIRE))
+            {
+                // A producer is in the middle of an insert.
+                return nullptr;
+            }
+            // Puts the stub back so that the last item can be removed.
+            stub_.next = nullptr;
+            insert(&stub_);
+            next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+            if (!next)
+            {
+                return nullptr;
+            }
+        }
+        set_tail(next);
+        tail->next = nullptr;
+        return tail;
+    }
+
+    /** Test if the queue is empty. May be called from any thread, but the
+     * result may be stale by the time it is returned.
+     * @return true if empty, else false
+     */
+    bool empty()
+    {
+        return __atomic_load_n(&head_, __ATOMIC_ACQUIRE) == &stub_ &&
+            __atomic_load_n(&tail_, __ATOMIC_ACQUIRE) == &stub_;
+    }
+
+private:
+    /// Updates tail_. @param tail new value.
+    void set_tail(QMember *tail)
+    {
+        __atomic_store_n(&tail_, tail, __ATOMIC_RELEASE);
+    }
+
+    /// Most recently inserted item. Written by the producers.
+    QMember *head_;
+    /// Oldest item, or the stub. Written by the consumer only.
+    QMember *tail_;
+    /// Placeholder item type.
+    struct Stub : public QMember
+    {
+    };
+
+    /// Placeholder item that makes it possible to remove the last item.
+    Stub stub_;
+
+    DISALLOW_COPY_AND_ASSIGN(QMpsc);
+};
+
+/** A list of lock-free multi-producer single-consumer queues, one per
+ * priority band. A drop-in replacement for QListProtected as an Executor's
+ * input queue where many threads add to the same executor: inserts do not
+ * take any lock. Only the insert, next and empty calls are supported.
+ */
+template <unsigned ITEMS> class QListMpsc
+{
+public:
+    typedef ::Result Result;
+
+    /** Add an item to the back of the queue. May be called from any thread.
+     * @param item to add to queue
+     * @param index in the list to operate on
+     */
+    void insert(QMember *item, unsigned index)
+    {
+        if (index >= ITEMS)
+        {
+            index = ITEMS - 1;
+        }
+        list_[index].insert(item);
+    }
+
+    /** Add an item to the back of the queue. Same as insert(), since no lock
+     * is needed.
+     * @param item to add to queue
+     * @param index in the list to operate on
+     */
+    void insert_locked(QMember *item, unsigned index)
+    {
+        insert(item, index);
+    }
+
+    /** Get an item from the front of the queue in priority order. Must be
+     * called only from the consumer thread.
+     * @return item retrieved from queue + index, NULL if no item available
+     */
+    Result next()
+    {
+        for (unsigned i = 0; i < ITEMS; ++i)
+        {
+            QMember *result = list_[i].next();
+            if (result)
+            {
+                return Result(result, i);
+            }
+        }
+        return Result();
+    }
+
+    /** Test if all the queues are empty.
+     * @return true if empty (all lists), else false
+     */
+    bool empty()
+    {
+        for (unsigned i = 0; i < ITEMS; ++i)
+        {
+            if (!list_[i].empty())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    /** the list of queues */
+    QMpsc list_[ITEMS];
+};
+
 
 #if 0
 /** A BufferQueue that adds the ability to wait on the next buffer.
@@ -85,6 +85,13 @@
  * vs the overhead used by the framework.
  */
 
+/** @var _sym_executor_use_epoll
+ *
+ * @brief If non-zero, executors on Linux wait for their FDs using epoll
+ * instead of select(). This is recommended for hubs that serve many TCP
+ * clients, since select() cannot take FDs above FD_SETSIZE (1024).
+ */
+
 /** @var _sym_can_tx_buffer_size
  * @brief default software buffer size for CAN transmission
  */
@@ -131,6 +138,7 @@ DEFAULT_CONST(main_thread_priority, 0xdefa01);
 DEFAULT_CONST(main_thread_stack_size, 2048);
 DEFAULT_CONST(executor_max_sleep_msec, 40);
 DEFAULT_CONST(executor_select_prescaler, 5);
+DEFAULT_CONST(executor_use_epoll, 0);
 
 DEFAULT_CONST(can_tx_buffer_size, 16);
 DEFAULT_CONST(can_rx_buffer_size, 16);
@@ -164,6 +172,17 @@ DEFAULT_CONST(directhub_port_incoming_buffer_size, 1460);
 // how many 1460-byte packets per port we parse before waiting for output to
 // drain.
 DEFAULT_CONST(directhub_port_max_incoming_packets, 2);
+// how many bytes a DirectHub source may send before yielding to other sources
+// (about 18 gridconnect frames).
+DEFAULT_CONST(directhub_admission_quantum_bytes, 512);
+
+#ifdef __FreeRTOS__
+/// Deferred logging rings are allocated per logging thread; keeps them small
+/// on MCUs.
+DEFAULT_CONST(binary_log_ring_size, 2048);
+#else
+DEFAULT_CONST(binary_log_ring_size, 65536);
+#endif
 
 #ifdef ESP_PLATFORM
 /// Use a stack size of 3kb for SocketListener tasks.
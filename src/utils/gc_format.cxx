@@ -34,10 +34,21 @@
 //#define LOGLEVEL VERBOSE
 
 #include <stdint.h>
+#include <string.h>
 #include "utils/logging.h"
 #include "utils/gc_format.h"
 #include "can_frame.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+/// Converts hex digits a 64-bit word at a time. This needs the characters
+/// to be in the same order in memory as the bytes in a little-endian word.
+#define GC_FORMAT_SWAR 1
+#endif
+
 extern "C" {
 
 /** Build an ASCII character representation of a nibble value (uppercase hex).
@@ -78,20 +89,143 @@ static int ascii_to_nibble(const char c)
     return -1;
 }
 
+#if GC_FORMAT_SWAR
 
-int gc_format_parse(const char* buf, struct can_frame* can_frame)
+/// Repeats a byte value in all bytes of a 64-bit word.
+#define GC_REP8(x) (0x0101010101010101ULL * (x))
+
+/// For a word where all bytes are below 0x80, sets the top bit of those bytes
+/// that are >= k.
+#define GC_GE(x, k) (((x) + GC_REP8(0x80 - (k))) & GC_REP8(0x80))
+
+/// Renders 4 bytes as 8 uppercase hex characters.
+/// @param v the bytes in memory order (i.e. as loaded into a little-endian
+/// word).
+/// @param dst where to write the 8 characters.
+static inline void swar_encode4(uint32_t v, char *dst)
+{
+    uint64_t x = v;
+    // Moves each byte into its own 16-bit lane.
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+    // The high nibble goes to the low byte of the lane, since it has to be
+    // printed first.
+    uint64_t n = ((x >> 4) & 0x000F000F000F000FULL) |
+        ((x & 0x000F000F000F000FULL) << 8);
+    // Adds 7 more to the nibbles that are >= 10 to get to 'A'.
+    uint64_t letter = ((n + GC_REP8(6)) >> 4) & GC_REP8(1);
+    n += GC_REP8('0') + letter * 7;
+    memcpy(dst, &n, 8);
+}
+
+/// Parses 8 hex characters (upper or lowercase) into 4 bytes.
+/// @param src the 8 characters.
+/// @param dst the parsed bytes in memory order (i.e. as stored from a
+/// little-endian word).
+/// @return false if any of the characters is not a hex digit.
+static inline bool swar_decode4(const char *src, uint32_t *dst)
+{
+    uint64_t c;
+    memcpy(&c, src, 8);
+    if (c & GC_REP8(0x80))
+    {
+        return false;
+    }
+    uint64_t digit = GC_GE(c, '0') & ~GC_GE(c, '9' + 1);
+    uint64_t lower = c | GC_REP8(0x20);
+    uint64_t letter = GC_GE(lower, 'a') & ~GC_GE(lower, 'f' + 1);
+    if ((digit | letter) != GC_REP8(0x80))
+    {
+        return false;
+    }
+    // Both '0'-'9' and 'A'-'F' have the value (minus 9 for letters) in the
+    // low nibble.
+    uint64_t n = (c & GC_REP8(0x0F)) + (letter >> 7) * 9;
+    // Combines the nibble pairs into the low byte of each 16-bit lane, then
+    // packs the lanes together.
+    n = ((n & 0x000F000F000F000FULL) << 4) | ((n >> 8) & 0x000F000F000F000FULL);
+    n = (n | (n >> 8)) & 0x0000FFFF0000FFFFULL;
+    n = (n | (n >> 16)) & 0xFFFFFFFFULL;
+    *dst = (uint32_t)n;
+    return true;
+}
+
+#undef GC_GE
+#undef GC_REP8
+
+#endif // GC_FORMAT_SWAR
+
+#if defined(__SSE2__)
+
+/// Renders 8 bytes as 16 uppercase hex characters.
+/// @param src the bytes.
+/// @param dst where to write the 16 characters.
+static inline void sse2_encode8(const uint8_t *src, char *dst)
+{
+    __m128i x = _mm_loadl_epi64((const __m128i *)src);
+    __m128i mask = _mm_set1_epi8(0x0f);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), mask);
+    __m128i lo = _mm_and_si128(x, mask);
+    __m128i n = _mm_unpacklo_epi8(hi, lo);
+    __m128i letter = _mm_and_si128(
+        _mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8('A' - '0' - 10));
+    n = _mm_add_epi8(n, _mm_add_epi8(letter, _mm_set1_epi8('0')));
+    _mm_storeu_si128((__m128i *)dst, n);
+}
+
+/// Parses 16 hex characters (upper or lowercase) into 8 bytes.
+/// @param src the 16 characters.
+/// @param dst where to write the 8 bytes.
+/// @return false if any of the characters is not a hex digit.
+static inline bool sse2_decode8(const char *src, uint8_t *dst)
+{
+    __m128i c = _mm_loadu_si128((const __m128i *)src);
+    // Characters >= 0x80 are negative and fail both range checks.
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+        _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+    __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    __m128i letter =
+        _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+            _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+    if (_mm_movemask_epi8(_mm_or_si128(digit, letter)) != 0xffff)
+    {
+        return false;
+    }
+    __m128i n = _mm_add_epi8(_mm_and_si128(c, _mm_set1_epi8(0x0f)),
+        _mm_and_si128(letter, _mm_set1_epi8(9)));
+    // Each 16-bit lane has the high nibble in the low byte and the low nibble
+    // in the high byte.
+    __m128i b = _mm_or_si128(
+        _mm_slli_epi16(_mm_and_si128(n, _mm_set1_epi16(0x00ff)), 4),
+        _mm_srli_epi16(n, 8));
+    b = _mm_packus_epi16(b, b);
+    _mm_storel_epi64((__m128i *)dst, b);
+    return true;
+}
+
+#endif // __SSE2__
+
+/// Parses the payload of a GridConnect packet.
+/// @param buf first character of the packet, optionally the leading ':'.
+/// @param end points after the last character of the packet, i.e. to the
+/// ';' or the terminating \0.
+/// @param can_frame the frame to fill in.
+/// @return 0 in case of success, -1 if there was a packet format error (in
+/// this case the frame is set to an error frame).
+static int parse_packet(
+    const char *buf, const char *end, struct can_frame *can_frame)
 {
     CLR_CAN_FRAME_ERR(*can_frame);
-    if (*buf == ':')
+    if (buf < end && *buf == ':')
     {
         // skip leading :
         ++buf;
     }
-    if (*buf == 'X')
+    if (buf < end && *buf == 'X')
     {
         SET_CAN_FRAME_EFF(*can_frame);
     }
-    else if (*buf == 'S') 
+    else if (buf < end && *buf == 'S') 
     {
         CLR_CAN_FRAME_EFF(*can_frame);
     } else
@@ -102,8 +236,23 @@ int gc_format_parse(const char* buf, struct can_frame* can_frame)
     }
     buf++;
     uint32_t id = 0;
+#if GC_FORMAT_SWAR
+    uint32_t word;
+    if (end - buf > 8 && (buf[8] == 'N' || buf[8] == 'R') &&
+        swar_decode4(buf, &word))
+    {
+        // Common case of an extended frame.
+        id = __builtin_bswap32(word);
+        buf += 8;
+    }
+#endif
     while (1)
     {
+        if (buf >= end)
+        {
+            SET_CAN_FRAME_ERR(*can_frame);
+            return -1;
+        }
         int nibble = ascii_to_nibble(*buf);
         if (nibble >= 0)
         {
@@ -140,43 +289,185 @@ int gc_format_parse(const char* buf, struct can_frame* can_frame)
     { 
         SET_CAN_FRAME_ID(*can_frame, id);
     }
+    int chars = end - buf;
+    if ((chars & 1) || chars > 16)
+    {
+        SET_CAN_FRAME_ERR(*can_frame);
+        return -1;
+    }
+    int len = chars / 2;
     int index = 0;
-    while ((*buf != 0) && (*buf != ';'))
+#if defined(__SSE2__)
+    if (len == 8)
+    {
+        if (!sse2_decode8(buf, can_frame->data))
+        {
+            SET_CAN_FRAME_ERR(*can_frame);
+            return -1;
+        }
+        index = 8;
+    }
+#endif
+#if GC_FORMAT_SWAR
+    for (; index + 4 <= len; index += 4)
     {
-        int nh = ascii_to_nibble(*buf++);
-        int nl = ascii_to_nibble(*buf++);
+        if (!swar_decode4(buf + index * 2, &word))
+        {
+            SET_CAN_FRAME_ERR(*can_frame);
+            return -1;
+        }
+        memcpy(can_frame->data + index, &word, 4);
+    }
+#endif
+    for (; index < len; ++index)
+    {
+        int nh = ascii_to_nibble(buf[index * 2]);
+        int nl = ascii_to_nibble(buf[index * 2 + 1]);
         if (nh < 0 || nl < 0)
         {
             SET_CAN_FRAME_ERR(*can_frame);
             return -1;
         }
-        can_frame->data[index++] = (nh << 4) | nl;
+        can_frame->data[index] = (nh << 4) | nl;
     } // while parsing data
-    can_frame->can_dlc = index;
-    CLR_CAN_FRAME_ERR(*can_frame);
+    can_frame->can_dlc = len;
     return 0;
 }
 
-/// Helper function for appending to a buffer ONCE.
-///
-/// @param dst buffer to append data to
-/// @param value one character to append to.
-///
-static void output_single(char*& dst, char value)
+int gc_format_parse(const char* buf, struct can_frame* can_frame)
 {
-    *dst++ = value;
+    const char *end = buf;
+    while (*end != 0 && *end != ';')
+    {
+        ++end;
+    }
+    return parse_packet(buf, end, can_frame);
 }
 
-/// Helper function for appending to a buffer TWICE. Used in the implementation
-/// of the double-byte gridconnect output protocol.
-///
-/// @param dst buffer to append data to
-/// @param value one character to append to.
+size_t gc_format_parse_many(const char *buf, size_t len,
+    struct can_frame *frames, size_t max_frames, size_t *consumed)
+{
+    const char *p = buf;
+    const char *end = buf + len;
+    size_t count = 0;
+    while (count < max_frames)
+    {
+        const char *start = (const char *)memchr(p, ':', end - p);
+        if (!start)
+        {
+            // Only garbage left.
+            p = end;
+            break;
+        }
+        const char *stop = (const char *)memchr(start, ';', end - start);
+        if (!stop)
+        {
+            // Incomplete packet; needs more data.
+            p = start;
+            break;
+        }
+        // A ':' restarts the packet, like in the stream parser.
+        const char *restart;
+        while ((restart = (const char *)memchr(
+                    start + 1, ':', stop - start - 1)) != nullptr)
+        {
+            start = restart;
+        }
+        if (parse_packet(start + 1, stop, frames + count) == 0)
+        {
+            ++count;
+        }
+        p = stop + 1;
+    }
+    *consumed = p - buf;
+    return count;
+}
+
+/// Formats a can frame in the single (not doubled) GridConnect protocol.
+/// @param can_frame is the input frame, must not be an error frame.
+/// @param buf is the output buffer (29 bytes).
+/// @param newline if true, appends a '\n' after the frame.
+/// @return the pointer to the buffer character after the formatted can frame.
+static char *render_packet(
+    const struct can_frame *can_frame, char *buf, bool newline)
+{
+    *buf++ = ':';
+    if (IS_CAN_FRAME_EFF(*can_frame))
+    {
+        uint32_t id = GET_CAN_FRAME_ID_EFF(*can_frame);
+        *buf++ = 'X';
+#if GC_FORMAT_SWAR
+        swar_encode4(__builtin_bswap32(id), buf);
+        buf += 8;
+#else
+        for (int offset = 28; offset >= 0; offset -= 4)
+        {
+            *buf++ = nibble_to_ascii(id >> offset);
+        }
+#endif
+    }
+    else
+    {
+        uint32_t id = GET_CAN_FRAME_ID(*can_frame);
+        *buf++ = 'S';
+        for (int offset = 8; offset >= 0; offset -= 4)
+        {
+            *buf++ = nibble_to_ascii(id >> offset);
+        }
+    }
+    /* handle remote or normal */
+    *buf++ = IS_CAN_FRAME_RTR(*can_frame) ? 'R' : 'N';
+    int index = 0;
+    int len = can_frame->can_dlc;
+#if defined(__SSE2__)
+    if (len == 8)
+    {
+        sse2_encode8(can_frame->data, buf);
+        buf += 16;
+        index = 8;
+    }
+#endif
+#if GC_FORMAT_SWAR
+    for (; index + 4 <= len; index += 4)
+    {
+        uint32_t word;
+        memcpy(&word, can_frame->data + index, 4);
+        swar_encode4(word, buf);
+        buf += 8;
+    }
+#endif
+    for (; index < len; ++index)
+    {
+        *buf++ = nibble_to_ascii(can_frame->data[index] >> 4);
+        *buf++ = nibble_to_ascii(can_frame->data[index]);
+    }
+    *buf++ = ';';
+    if (newline)
+    {
+        *buf++ = '\n';
+    }
+    return buf;
+}
+
+/// Converts a rendered packet in place to the double-byte gridconnect
+/// protocol, which has a leading !!, and all the other characters doubled.
 ///
-static void output_double(char*& dst, char value)
+/// @param start first character of the packet (the ':').
+/// @param end points after the last character of the packet. The buffer must
+/// have space for end - start more characters.
+/// @return pointer after the doubled packet.
+static char *double_packet(char *start, char *end)
 {
-    *dst++ = value;
-    *dst++ = value;
+    char *dst = end + (end - start);
+    char *ret = dst;
+    while (end > start)
+    {
+        --end;
+        *--dst = *end;
+        *--dst = *end;
+    }
+    start[0] = start[1] = '!';
+    return ret;
 }
 
 /** Formats a can frame in the GridConnect protocol.
@@ -203,53 +494,31 @@ char* gc_format_generate(const struct can_frame* can_frame, char* buf, int doubl
         LOG(VERBOSE, "GC generate: incoming frame ERR.");
         return buf;
     }
-    void (*output)(char*& dst, char value);
+    char *end = render_packet(
+        can_frame, buf, config_gc_generate_newlines() == CONSTANT_TRUE);
     if (double_format)
     {
-        output = output_double;
-        output(buf, '!');
-    }
-    else
-    {
-        output = output_single;
-        output(buf, ':');
-    }
-    uint32_t id;
-    int offset;
-    if (IS_CAN_FRAME_EFF(*can_frame))
-    {
-        id = GET_CAN_FRAME_ID_EFF(*can_frame);
-        output(buf, 'X');
-        offset = 28;
-    }
-    else
-    {
-        id = GET_CAN_FRAME_ID(*can_frame);
-        output(buf, 'S');
-        offset = 8;
-    }
-    for (;offset >= 0; offset -= 4)
-    {
-        output(buf, nibble_to_ascii((id >> offset) & 0xf));
+        end = double_packet(buf, end);
     }
-    /* handle remote or normal */
-    if (IS_CAN_FRAME_RTR(*can_frame))
-    {
-        output(buf, 'R');
-    }
-    else
-    {
-        output(buf, 'N');
-    }
-    for (offset = 0; offset < can_frame->can_dlc; ++offset)
-    {
-        output(buf, nibble_to_ascii(can_frame->data[offset] >> 4));
-        output(buf, nibble_to_ascii(can_frame->data[offset] & 0xf));
-    }
-    output(buf, ';');
-    if (config_gc_generate_newlines() == CONSTANT_TRUE)
+    return end;
+}
+
+char *gc_format_generate_many(const struct can_frame *frames, size_t count,
+    char *buf, int double_format)
+{
+    bool newline = config_gc_generate_newlines() == CONSTANT_TRUE;
+    for (size_t i = 0; i < count; ++i)
     {
-        output(buf, '\n');
+        if (IS_CAN_FRAME_ERR(frames[i]))
+        {
+            continue;
+        }
+        char *end = render_packet(frames + i, buf, newline);
+        if (double_format)
+        {
+            end = double_packet(buf, end);
+        }
+        buf = end;
     }
     return buf;
 }
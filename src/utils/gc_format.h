@@ -36,6 +36,8 @@
 
 #include "utils/constants.hxx"
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -79,6 +81,48 @@ int gc_format_parse(const char* buf, struct can_frame* can_frame);
 */
 char* gc_format_generate(const struct can_frame* can_frame, char* buf, int double_format);
 
+/** Parses a sequence of GridConnect packets from a character buffer.
+
+    Each packet starts with ':' and ends with ';'. Characters between the
+    packets (such as newlines) are skipped. Packets that have a format error
+    are skipped.
+
+    @param buf points to the characters to parse.
+
+    @param len is the number of characters in buf.
+
+    @param frames is where the parsed frames will be stored.
+
+    @param max_frames is the number of entries in frames. Parsing stops when
+    this many frames are filled.
+
+    @param consumed will be set to the number of characters that were used
+    up. Parsing stops before an incomplete packet at the end of the buffer;
+    the caller should present these characters again when more data arrives.
+
+    @return the number of frames written to frames.
+*/
+size_t gc_format_parse_many(const char *buf, size_t len,
+    struct can_frame *frames, size_t max_frames, size_t *consumed);
+
+/** Formats a number of can frames in the GridConnect protocol into a
+    contiguous buffer. Error frames are skipped.
+
+    @param frames points to the input frames.
+
+    @param count is the number of frames.
+
+    @param buf is the output buffer. The caller must ensure this is big enough
+    to hold count frames of 29 bytes each (58 with double_format).
+
+    @param double_format if non-zero, the doubling format will be generated.
+
+    @return the pointer to the buffer character after the last formatted can
+    frame.
+*/
+char *gc_format_generate_many(const struct can_frame *frames, size_t count,
+    char *buf, int double_format);
+
 #ifdef __cplusplus
 }
 #endif
@@ -105,21 +105,51 @@ extern os_mutex_t g_log_mutex;
         }                                                                      \
         else if (level == FATAL)                                               \
         {                                                                      \
+            LOG_FLUSH_DEFERRED();                                              \
             fprintf(stderr, message);                                          \
             fprintf(stderr, "\n");                                             \
             abort();                                                           \
         }                                                                      \
         else if (LOGLEVEL >= level)                                            \
         {                                                                      \
-            LOCK_LOG;                                                          \
-            int sret = snprintf(logbuffer, sizeof(logbuffer), message);        \
-            if (sret > (int)sizeof(logbuffer))                                 \
-                sret = sizeof(logbuffer);                                      \
-            GLOBAL_LOG_OUTPUT(logbuffer, sret);                                \
-            UNLOCK_LOG;                                                        \
+            LOG_RENDER(message);                                               \
         }                                                                      \
     } while (0)
 
+#if defined(__cplusplus) && defined(DEFERRED_LOGGING)
+/// Deferred mode (define DEFERRED_LOGGING in the compiler flags): the log line
+/// is stored in binary form in a per-thread ring buffer without locking, and
+/// rendered later by BinaryLog::drain(), typically from a BinaryLogFlow. Each
+/// logging thread allocates a ring of config_binary_log_ring_size() bytes. The
+/// dead printf keeps the compiler's format string checks.
+#define LOG_RENDER(message...)                                                 \
+    do                                                                         \
+    {                                                                          \
+        if (0)                                                                 \
+        {                                                                      \
+            printf(message);                                                   \
+        }                                                                      \
+        ::BinaryLog::record(message);                                          \
+    } while (0)
+/// Writes out the pending deferred log lines before the process dies. Skipped
+/// if the logging locks are taken, to avoid a deadlock.
+#define LOG_FLUSH_DEFERRED() ::BinaryLog::try_drain()
+#else
+/// Renders a log line into the log buffer and writes it to the log output.
+#define LOG_RENDER(message...)                                                 \
+    do                                                                         \
+    {                                                                          \
+        LOCK_LOG;                                                              \
+        int sret = snprintf(logbuffer, sizeof(logbuffer), message);            \
+        if (sret > (int)sizeof(logbuffer))                                     \
+            sret = sizeof(logbuffer);                                          \
+        GLOBAL_LOG_OUTPUT(logbuffer, sret);                                    \
+        UNLOCK_LOG;                                                            \
+    } while (0)
+/// Nothing to flush when log lines are written synchronously.
+#define LOG_FLUSH_DEFERRED()
+#endif
+
 /// Shorthand for LOG(LEVEL_ERROR, message...). See @ref LOG.
 #define LOG_ERROR(message...) LOG(LEVEL_ERROR, message)
 
@@ -132,6 +162,10 @@ extern char logbuffer[1024];
 extern char logbuffer[256];
 #endif
 
+#if defined(__cplusplus) && defined(DEFERRED_LOGGING)
+#include "utils/BinaryLog.hxx"
+#endif
+
 #ifndef LOGLEVEL
 #ifdef __FreeRTOS__
 #define LOGLEVEL FATAL